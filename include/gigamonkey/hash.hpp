@@ -5,6 +5,7 @@
 #define GIGAMONKEY_HASH
 
 #include "types.hpp"
+#include <vector>
 #include <data/data.hpp>
 #include <data/encoding/integer.hpp>
 #include <data/math/number/bytes/N.hpp>
@@ -156,6 +157,72 @@ namespace Gigamonkey {
         digest160 hash160(string_view b);
         digest256 hash256(string_view b);
         
+        // hash many messages at once. The messages are spread over the lanes of 
+        // a SIMD kernel, or over the SHA extensions, as detected on this cpu. 
+        // The result is the same as calling hash256 on each message. 
+        void hash256_many(const bytes_view* messages, digest256* digests, size_t count);
+        std::vector<digest256> hash256_many(const std::vector<bytes_view>& messages);
+        
+        // name of the kernel that hash256_many uses. 
+        const string& hash256_engine();
+        
+        // every kernel that runs on this cpu, best first, so that 
+        // each one can be tested. The first is the one that is used. 
+        std::vector<string> hash256_engines();
+        
+        // hash256_many with the named kernel. Returns false if 
+        // the kernel does not run on this cpu. 
+        bool hash256_many(const string& engine, const bytes_view* messages, digest256* digests, size_t count);
+        
+        // the SHA-256 state after the first 64 bytes of a message. 
+        void sha256_midstate(const byte* first_block, uint32* state);
+        
+        // hash256 of an 80 byte message, given the state after its 
+        // first 64 bytes and the remaining 16 bytes. 
+        digest256 hash256_80(const uint32* midstate, const byte* tail);
+        
+        // hash 80 byte messages with the given midstate whose last four bytes are 
+        // the nonces in [begin, begin + count), several at once on cpus with wide 
+        // vector instructions. Only the top 32 bits of each digest, read as a little 
+        // endian number, are compared against top. The scan stops after finding 
+        // candidates, which must be checked against the full target. There can be 
+        // up to 16 candidates. Returns the number of nonces that were scanned. 
+        uint32 hash256_80_scan(const uint32* midstate, const byte* tail, 
+            uint32 begin, uint32 count, uint32 top, uint32* candidates, uint32& found);
+        
+        const string& hash256_80_scan_engine();
+        
+        // every scan kernel that runs on this cpu, best first. 
+        std::vector<string> hash256_80_scan_engines();
+        
+        // hash256_80_scan with the named kernel. Returns 0 with no 
+        // candidates if the kernel does not run on this cpu. 
+        uint32 hash256_80_scan(const string& engine, const uint32* midstate, const byte* tail, 
+            uint32 begin, uint32 count, uint32 top, uint32* candidates, uint32& found);
+        
+        // hash256 of messages that all begin with the same bytes. The whole 
+        // blocks of the beginning are hashed once, so that only the rest of 
+        // each message needs to be hashed. 
+        struct hash256_prefix {
+            std::array<uint32, 8> State;
+            
+            // the end of the prefix, which does not fill a block. 
+            std::array<byte, 64> Rest;
+            
+            // size of the prefix. 
+            uint64 Length;
+            
+            hash256_prefix();
+            explicit hash256_prefix(bytes_view prefix);
+            
+            // hash256 of the prefix followed by each of the parts. 
+            digest256 operator()(const bytes_view* parts, size_t count) const;
+            
+            digest256 operator()(bytes_view rest) const {
+                return operator()(&rest, 1);
+            }
+        };
+        
         inline digest160 address_hash(bytes_view b) {
             return hash160(b);
         }
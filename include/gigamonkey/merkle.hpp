@@ -5,6 +5,7 @@
 #define GIGAMONKEY_MERKLE
 
 #include "hash.hpp"
+#include <memory>
 
 namespace Gigamonkey::Merkle {
     
@@ -19,6 +20,18 @@ namespace Gigamonkey::Merkle {
     
     digest root(leaf_digests l);
     
+    // compute the root over a contiguous array of leaf digests. 
+    // Each level is written over the one below it, so the array
+    // is used as scratch space and its contents are lost. 
+    digest root(digest* leaves, uint32 width);
+    
+    inline digest root(std::vector<digest> leaves) {
+        return root(leaves.data(), leaves.size());
+    }
+    
+    // the leaves are left alone and the tree is built on the given number of threads. 
+    digest root(const digest* leaves, uint32 width, uint32 threads);
+    
     using digests = stack<digest>;
     
     struct path final {
@@ -101,6 +114,9 @@ namespace Gigamonkey::Merkle {
         
         static tree make(leaf_digests);
         
+        // build the tree on the given number of threads. 
+        static tree make(leaf_digests, uint32 threads);
+        
         tree();
         explicit tree(const digest& root);
         explicit tree(leaf_digests h) : tree{make(h)} {}
@@ -163,29 +179,173 @@ namespace Gigamonkey::Merkle {
         return dual{a} + b;
     }
     
+    // the paths of several leaves of one tree, with each digest they share 
+    // stored only once. Digests are in the order they are needed to compute 
+    // the root: level by level from the leaves, left to right, so that 
+    // every node is hashed once. 
+    struct multiproof final {
+        // in order of index. 
+        std::vector<leaf> Leaves;
+        
+        // the number of digests in each path. 
+        uint32 Height;
+        
+        std::vector<digest> Digests;
+        digest Root;
+        
+        multiproof() : Leaves{}, Height{0}, Digests{}, Root{} {}
+        multiproof(std::vector<leaf> l, uint32 h, std::vector<digest> d, const digest& root) : 
+            Leaves{l}, Height{h}, Digests{d}, Root{root} {}
+        
+        // the multiproof is empty if the paths are not all the same length. 
+        explicit multiproof(const dual&);
+        
+        // the root computed from the leaves, or nothing if the proof is malformed. 
+        digest derive_root() const;
+        
+        bool valid() const {
+            return Root.valid() && derive_root() == Root;
+        }
+    };
+    
     // for serving branches. Would be on a miner's computer. 
+    // Everything is kept in one contiguous buffer which can be written to 
+    // a file and memory-mapped back, so that no parsing is needed on restart. 
     class server final {
-        cross<digest> Digests;
-        data::map<digest, uint32> Indices;
+        struct buffer;
+        
+        std::shared_ptr<buffer> Buffer;
         
-        server() : Digests{}, Indices{}, Width{0}, Height{0} {}
+        // beginning of each level in Digests, starting with the leaves. 
+        std::vector<uint32> Offsets;
+        
+        const digest* Digests;
+        
+        // open-addressing hash table from leaf digest to leaf index + 1. 
+        const uint32_little* Index;
+        uint32 Slots;
+        
+        server() : Buffer{}, Offsets{}, Digests{nullptr}, Index{nullptr}, Slots{0}, Width{0}, Height{0} {}
+        
+        static server allocate(uint32 width);
+        void attach(std::shared_ptr<buffer>, uint32 width);
+        digest* digests();
+        void index();
+        uint32 find(const digest&) const;
+        
+        // width of a level, where the leaves are level zero. 
+        uint32 width(uint32 level) const;
+        
+        // update the path of the previous leaf to the path of leaf i. 
+        void next_path(digest* path, uint32 i) const;
         
     public:
         uint32 Width;
         uint32 Height;
         
-        server(leaf_digests);
+        // the leaves are split into subtrees which are hashed on the given number of threads. 
+        server(leaf_digests, uint32 threads = 1);
+        explicit server(const std::vector<digest>&, uint32 threads = 1);
         server(const tree&);
         
         operator tree() const;
         
         digest root() const;
         
+        // the digest at the given index of a level, where the leaves are level zero. 
+        const digest& operator()(uint32 level, uint32 index) const;
+        
         list<proof> proofs() const;
         
+        // the path of leaf i has Height - 1 digests, starting next to the leaf. 
+        // Paths are written one after another, leaf by leaf, into an array of 
+        // Width * (Height - 1) digests, which must already be allocated. 
+        void all_paths(digest* paths) const;
+        std::vector<digest> all_paths() const;
+        
+        // call f(index, path) for every leaf in order. The path is only good 
+        // until the next call. Leaves next to each other have nearly the same 
+        // path, so only the part that changes is written for each leaf. 
+        template <typename f> void all_paths(f each) const;
+        
         proof operator[](const digest& d) const;
         
         bool operator==(const server& s) const;
+        
+        // returns false if the file could not be written. 
+        bool write(const string& filename) const;
+        
+        // map a file created by write. The server is empty if the file is not valid. 
+        static server map(const string& filename);
+    };
+    
+    // builds a tree one leaf at a time while keeping only its right edge. 
+    // Good for block templates, which gain transactions as they arrive. 
+    // Appending a leaf costs one hash on average. 
+    class accumulator final {
+        // roots of complete subtrees that have not yet been paired, by level. 
+        std::array<digest, 32> Inner;
+        
+        // right neighbors of the nodes above the first leaf, by level. 
+        std::array<digest, 32> Left;
+        
+        digest fold(uint32 count, uint32 level) const;
+        
+    public:
+        uint32 Width;
+        
+        accumulator() : Inner{}, Left{}, Width{0} {}
+        
+        accumulator& append(const digest&);
+        
+        accumulator& operator<<(const digest& d) {
+            return append(d);
+        }
+        
+        digest root() const;
+        
+        // path of the first leaf, which is the coinbase in a block. 
+        // It does not depend on the first leaf, which may be a placeholder. 
+        path coinbase() const;
+    };
+    
+    // keeps every node of a block's tree that does not depend on the coinbase, 
+    // which is all of them except the first on each level. When transactions 
+    // are appended or replaced, only the nodes above them are hashed again, 
+    // so the coinbase path for mining.notify can be refreshed quickly. 
+    class coinbase_cache final {
+        // levels starting with the leaves. The first digest of each level is unknown. 
+        std::vector<std::vector<digest>> Levels;
+        
+        // rehash the nodes above leaves [begin, end). 
+        void update(uint32 begin, uint32 end);
+        
+    public:
+        coinbase_cache() : Levels{{digest{}}} {}
+        
+        // the transactions after the coinbase, in order. 
+        explicit coinbase_cache(const std::vector<digest>& transactions);
+        
+        // number of leaves, including the coinbase. 
+        uint32 width() const {
+            return Levels[0].size();
+        }
+        
+        coinbase_cache& append(const digest&);
+        coinbase_cache& append(const std::vector<digest>&);
+        
+        coinbase_cache& operator<<(const digest& d) {
+            return append(d);
+        }
+        
+        // replace the transaction at the given index in the block, which cannot 
+        // be zero. Returns false if there is no transaction there. 
+        bool replace(uint32 index, const digest&);
+        
+        // the path of the coinbase, as in notify::parameters::Path. 
+        digests path() const;
+        
+        digest root(const digest& coinbase) const;
     };
     
     inline std::ostream& operator<<(std::ostream& o, const path& p) {
@@ -312,6 +472,14 @@ namespace Gigamonkey::Merkle {
         return !(a == b);
     }
     
+    inline bool operator==(const multiproof& a, const multiproof& b) {
+        return a.Root == b.Root && a.Height == b.Height && a.Leaves == b.Leaves && a.Digests == b.Digests;
+    }
+    
+    inline bool operator!=(const multiproof& a, const multiproof& b) {
+        return !(a == b);
+    }
+    
     inline path::path() : Index{0}, Digests{} {}
     
     inline path::path(uint32 i, const digests p) : Index{i}, Digests{p} {}
@@ -373,11 +541,25 @@ namespace Gigamonkey::Merkle {
     inline tree::tree(const digest& root) : data::tree<digest>{root}, Width{1}, Height{1} {}
     
     inline digest server::root() const {
-        return Digests[-1];
+        if (Width == 0) return {};
+        return Digests[Offsets.back()];
     }
-        
-    inline bool server::operator==(const server& s) const {
-        return Width == s.Width && Height == s.Height && Digests == s.Digests;
+    
+    inline const digest& server::operator()(uint32 level, uint32 index) const {
+        return Digests[Offsets[level] + index];
+    }
+    
+    inline uint32 server::width(uint32 level) const {
+        return level + 1 < Offsets.size() ? Offsets[level + 1] - Offsets[level] : 1;
+    }
+    
+    template <typename f> void server::all_paths(f each) const {
+        if (Width == 0) return;
+        std::vector<digest> path(Height - 1);
+        for (uint32 i = 0; i < Width; i++) {
+            next_path(path.data(), i);
+            each(i, const_cast<const digest*>(path.data()));
+        }
     }
 }
 
@@ -0,0 +1,109 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_CLIENT
+#define GIGAMONKEY_STRATUM_CLIENT
+
+#include <gigamonkey/stratum/mining_subscribe.hpp>
+#include <gigamonkey/stratum/mining_authorize.hpp>
+#include <gigamonkey/stratum/mining_submit.hpp>
+#include <gigamonkey/stratum/mining_notify.hpp>
+#include <gigamonkey/stratum/mining_set_difficulty.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace Gigamonkey::Stratum {
+
+    // a Stratum client, which connects to a server, subscribes, and
+    // authorizes a worker.
+    //
+    // Requests are written as soon as they are made without waiting for
+    // earlier ones to be answered, and responses are matched to requests
+    // by id. Thus any number of shares may be in flight at once.
+    //
+    // The connection is handled on a thread that belongs to the client.
+    // Callbacks are called on that thread, so they must not wait for
+    // responses from the server.
+    class client {
+    public:
+        struct options {
+            string Address;
+            uint16 Port;
+            string UserAgent;
+            worker_name Username;
+            std::optional<string> Password;
+
+            // the connection is closed if the server sends a longer message.
+            uint32 MaxMessageSize;
+
+            // how long to wait for the server to answer when subscribing
+            // and authorizing.
+            std::chrono::milliseconds Timeout;
+
+            options() : Address{"127.0.0.1"}, Port{3333}, UserAgent{"gigamonkey"},
+                Username{}, Password{}, MaxMessageSize{1 << 20}, Timeout{std::chrono::seconds{10}} {}
+        };
+
+        // called when the server sends a job.
+        std::function<void(const mining::notify::parameters&)> Notify;
+
+        // called when the server changes the difficulty.
+        std::function<void(const difficulty&)> SetDifficulty;
+
+        client(const options& = options{});
+        ~client();
+
+        client(const client&) = delete;
+        client& operator=(const client&) = delete;
+
+        // connect, subscribe, and authorize. Returns false if any of these fail
+        // or if the server does not answer in time. The client may be started
+        // again once its connection has closed, whether it was stopped or the
+        // server hung up, but not while other threads are sending requests.
+        bool start();
+
+        // close the connection. Requests that have not been answered fail.
+        void stop();
+
+        bool connected() const;
+
+        // available once the client has subscribed.
+        session_id extra_nonce_1() const;
+        uint32 extra_nonce_2_size() const;
+
+        // the latest difficulty sent by the server.
+        difficulty share_difficulty() const;
+
+        // the number of requests that have not been answered.
+        uint32 pending() const;
+
+        // send a request. The response is empty if the connection closes first.
+        void send(method, const parameters&, std::function<void(const response&)>);
+        std::future<response> send(method, const parameters&);
+
+        // whether the share was accepted.
+        void submit(const share&, std::function<void(bool)>);
+        std::future<bool> submit(const share&);
+
+    private:
+        struct connection;
+
+        void send(request_id, std::shared_ptr<const string>, std::function<void(const response&)>);
+
+        options Options;
+        std::unique_ptr<connection> Connection;
+
+        std::atomic<request_id> NextID;
+        std::atomic<uint32> Pending;
+        std::atomic<uint64> Difficulty;
+
+        session_id ExtraNonce1;
+        uint32 ExtraNonce2Size;
+    };
+
+}
+
+#endif
@@ -0,0 +1,38 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_CODEC
+#define GIGAMONKEY_STRATUM_CODEC
+
+#include <gigamonkey/stratum/mining_notify.hpp>
+#include <gigamonkey/stratum/mining_submit.hpp>
+
+// reads and writes the messages that make up most Stratum traffic
+// without building a json tree.
+//
+// Messages are read straight from the text into the objects they
+// represent, reusing the storage those objects already have. Messages
+// are written by appending to a string, so the same buffer can be used
+// for message after message. What is written is exactly what the json
+// types write.
+//
+// A decode function returns false for anything it does not understand,
+// such as unicode escapes, in which case the message can still be read
+// with the json types.
+namespace Gigamonkey::Stratum::codec {
+
+    // mining.submit request.
+    bool decode(string_view, request_id&, share&);
+    void encode(string&, request_id, const share&);
+
+    // mining.notify notification.
+    bool decode(string_view, mining::notify::parameters&);
+    void encode(string&, const mining::notify::parameters&);
+
+    // a response with a boolean result, which is how a share is answered.
+    bool decode(string_view, request_id&, bool&);
+    void encode(string&, request_id, bool);
+
+}
+
+#endif
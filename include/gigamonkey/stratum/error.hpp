@@ -10,7 +10,13 @@ namespace Gigamonkey::Stratum {
     
     // Stratum error codes (incomplete)
     enum error_code : uint32 {
-        none
+        none, 
+        other = 20, 
+        job_not_found = 21, 
+        duplicate_share = 22, 
+        low_difficulty_share = 23, 
+        unauthorized_worker = 24, 
+        not_subscribed = 25
     };
     
     std::string error_message_from_code(error_code);
@@ -0,0 +1,132 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_JOB_REGISTRY
+#define GIGAMONKEY_STRATUM_JOB_REGISTRY
+
+#include <gigamonkey/stratum/mining_notify.hpp>
+#include <gigamonkey/stratum/share_set.hpp>
+#include <gigamonkey/stratum/readers.hpp>
+#include <gigamonkey/work/proof.hpp>
+#include <gigamonkey/hash.hpp>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Gigamonkey::Stratum {
+
+    // the jobs that shares may be submitted for, by job id.
+    //
+    // The jobs are kept in an immutable table. A new job makes a new table,
+    // which replaces the old one all at once. Threads that look up jobs take
+    // no lock. They are counted as readers of the table while they use it,
+    // and the thread that replaces the table waits for those readers to
+    // finish before deleting the old one. A clean job replaces every job
+    // before it in the same step. Jobs are also removed, oldest first, to
+    // keep the registry under max size in bytes.
+    //
+    // The ids of the last max retired jobs to be removed are remembered so
+    // that a share for one of them can be told apart from a share for a job
+    // that never existed.
+    class job_registry {
+    public:
+        // a job along with everything about it that does not
+        // depend on the share.
+        struct entry {
+            job_id ID;
+            work::puzzle Puzzle;
+            Bitcoin::timestamp Now;
+
+            // the state after hashing the first part of the coinbase.
+            Bitcoin::hash256_prefix Coinbase;
+
+            // the merkle path from the coinbase up.
+            std::vector<digest256> Path;
+
+            // shares that have been accepted for the job. The
+            // set is safe to insert into from any thread.
+            mutable share_set Shares;
+
+            // roughly how much memory the job takes up.
+            size_t Size;
+
+            entry(const mining::notify::parameters&, uint32 max_shares, uint64 seed);
+
+            digest256 merkle_root(const session_id& n1, const uint64_big& n2) const;
+        };
+
+        enum status {
+            found,
+            stale,
+            unknown
+        };
+
+        struct lookup {
+            status Status;
+
+            // null unless the job was found.
+            std::shared_ptr<const entry> Job;
+
+            lookup(status s, std::shared_ptr<const entry> j = nullptr) : Status{s}, Job{j} {}
+        };
+
+        const size_t MaxSize;
+        const uint32 MaxRetired;
+
+        // how many shares can be accepted for one job.
+        const uint32 MaxShares;
+
+        explicit job_registry(size_t max_size = 1 << 28, uint32 max_retired = 1024, uint32 max_shares = 1 << 16);
+        ~job_registry();
+
+        job_registry(const job_registry&) = delete;
+        job_registry& operator=(const job_registry&) = delete;
+
+        // add a job, replacing any job with the same id.
+        bool notify(const mining::notify::parameters&);
+
+        // the job is retired, so that shares for it are stale.
+        bool remove(job_id);
+
+        lookup find(job_id) const;
+
+        size_t jobs() const;
+
+        // the total size of the jobs in the registry.
+        size_t size() const;
+
+    private:
+        struct table {
+            std::unordered_map<job_id, std::shared_ptr<const entry>> Jobs;
+
+            // oldest first.
+            std::deque<job_id> Order;
+            size_t Size;
+
+            std::unordered_set<job_id> Retired;
+            std::deque<job_id> RetiredOrder;
+
+            table() : Jobs{}, Order{}, Size{0}, Retired{}, RetiredOrder{} {}
+
+            void erase(job_id);
+            void retire(job_id, uint32 max);
+        };
+
+        // only taken by threads that change the jobs.
+        std::mutex Mutex;
+
+        std::atomic<const table*> Table;
+        readers Readers;
+
+        // replace the table and delete the old one once nobody
+        // can be reading it. Called with the mutex held.
+        void publish(const table*);
+    };
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_READERS
+#define GIGAMONKEY_STRATUM_READERS
+
+#include <gigamonkey/types.hpp>
+#include <atomic>
+#include <thread>
+
+namespace Gigamonkey::Stratum {
+
+    // lets threads read objects through atomic pointers without locks
+    // while another thread replaces them now and then.
+    //
+    // A reader is counted under the current generation, which is 0 or 1,
+    // for as long as it is reading. A writer that has swapped out a pointer
+    // changes the generation and waits for the readers counted under the
+    // old one before deleting the old object. A reader that loaded the old
+    // pointer saw the old generation after it was counted, so it is one of
+    // them. Readers that come later are counted under the new generation,
+    // so the writer does not wait for them.
+    class readers {
+    public:
+        // counts a thread as a reader for as long as it exists.
+        class reader {
+            const readers& Readers;
+            uint32 Generation;
+
+        public:
+            explicit reader(const readers&);
+            ~reader();
+
+            reader(const reader&) = delete;
+            reader& operator=(const reader&) = delete;
+        };
+
+        readers() : Generation{0}, Count{} {}
+
+        readers(const readers&) = delete;
+        readers& operator=(const readers&) = delete;
+
+        // wait until every reader that was counted before the call is done.
+        // Calls must not overlap, so writers need a lock of their own.
+        void wait();
+
+    private:
+        std::atomic<uint32> Generation;
+        mutable std::atomic<uint32> Count[2];
+    };
+
+    // if the generation changes before the reader is counted, it
+    // tries again under the new generation.
+    inline readers::reader::reader(const readers& r) : Readers{r}, Generation{r.Generation.load()} {
+        while (true) {
+            Readers.Count[Generation]++;
+            uint32 g = Readers.Generation.load();
+            if (g == Generation) return;
+            Readers.Count[Generation]--;
+            Generation = g;
+        }
+    }
+
+    inline readers::reader::~reader() {
+        Readers.Count[Generation]--;
+    }
+
+    inline void readers::wait() {
+        uint32 g = Generation.load();
+        Generation = 1 - g;
+        while (Count[g].load() != 0) std::this_thread::yield();
+    }
+
+}
+
+#endif
@@ -0,0 +1,116 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_SERVER
+#define GIGAMONKEY_STRATUM_SERVER
+
+#include <gigamonkey/stratum/mining_subscribe.hpp>
+#include <gigamonkey/stratum/mining_authorize.hpp>
+#include <gigamonkey/stratum/mining_submit.hpp>
+#include <gigamonkey/stratum/mining_notify.hpp>
+#include <gigamonkey/stratum/mining_set_difficulty.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Gigamonkey::Stratum {
+
+    // a Stratum server. Messages are json objects separated by newlines.
+    //
+    // Each connection must first subscribe, which gives it an extra nonce 1,
+    // and then authorize a worker. After that it is sent the difficulty and
+    // the latest job, and may submit shares.
+    //
+    // The server runs one thread per core, each of which has its own
+    // listening socket on the same port (with SO_REUSEPORT) so that the
+    // kernel spreads connections between them. A connection is handled
+    // entirely on the thread that accepted it, so sessions need no locks.
+    // An idle session holds its socket and a read buffer that is never
+    // allowed to grow beyond the longest allowed message.
+    class server {
+    public:
+        // the mining pool behind the server. Its functions are called
+        // from the server's threads and must be thread safe.
+        struct pool {
+            // whether the worker may submit shares.
+            virtual bool authorize(const worker&, const mining::authorize_request::parameters&) = 0;
+
+            // whether the share is accepted.
+            virtual bool submit(const worker&, const share&) = 0;
+
+            virtual ~pool() {}
+        };
+
+        struct options {
+            string Address;
+
+            // zero means to choose any available port.
+            uint16 Port;
+
+            // zero means one thread per core.
+            uint32 Threads;
+
+            // a connection that sends a longer message is closed.
+            uint32 MaxMessageSize;
+
+            // a connection that falls this many bytes behind in
+            // reading what we send to it is closed.
+            uint32 MaxQueueSize;
+
+            // the difficulty sent to a worker once it is authorized.
+            difficulty Difficulty;
+
+            options() : Address{"0.0.0.0"}, Port{0}, Threads{0},
+                MaxMessageSize{4096}, MaxQueueSize{1 << 16}, Difficulty{1} {}
+        };
+
+        server(pool&, const options& = options{});
+        ~server();
+
+        server(const server&) = delete;
+        server& operator=(const server&) = delete;
+
+        // begin to accept connections. Returns false if
+        // the server could not listen on the given address.
+        bool start();
+
+        // close all connections and wait for the threads to finish.
+        void stop();
+
+        // the port on which the server is listening.
+        uint16 port() const;
+
+        // the number of open connections.
+        uint32 sessions() const;
+
+        // send a job to every authorized worker. The job is also
+        // sent to workers that are authorized later on. It is
+        // serialized once, no matter how many workers there are.
+        void notify(const mining::notify::parameters&);
+
+    private:
+        struct session;
+        struct context;
+
+        pool& Pool;
+        options Options;
+
+        std::vector<std::unique_ptr<context>> Contexts;
+        std::vector<std::thread> Threads;
+
+        std::atomic<uint32> ExtraNonce1;
+        std::atomic<uint32> Sessions;
+
+        // the latest job, which is given to each context when the
+        // server starts. Sessions use their context's copy.
+        std::mutex Mutex;
+        std::shared_ptr<const string> Job;
+
+        uint16 Port;
+    };
+
+}
+
+#endif
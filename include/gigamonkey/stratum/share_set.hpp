@@ -0,0 +1,148 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_SHARE_SET
+#define GIGAMONKEY_STRATUM_SHARE_SET
+
+#include <gigamonkey/stratum/session_id.hpp>
+#include <gigamonkey/work/proof.hpp>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace Gigamonkey::Stratum {
+
+    // the shares that have been submitted for one job, by extra nonce 1,
+    // extra nonce 2, timestamp, and nonce.
+    //
+    // This is an open addressing hash table of fixed size which can be
+    // used from any number of threads without locks. A slot is claimed
+    // with compare and swap, filled in, and then marked as full. A thread
+    // that comes to a slot that is being filled waits for the few
+    // instructions it takes to fill it. Once max shares have been inserted,
+    // no more can be added. The set is removed along with its job.
+    class share_set {
+        enum : uint32 {empty, filling, full};
+
+        struct slot {
+            std::atomic<uint32> State;
+            uint32 ExtraNonce1;
+            uint32 Timestamp;
+            uint32 Nonce;
+            uint64 ExtraNonce2;
+
+            slot() : State{empty}, ExtraNonce1{0}, Timestamp{0}, Nonce{0}, ExtraNonce2{0} {}
+        };
+
+        std::unique_ptr<slot[]> Slots;
+        uint32 Mask;
+        uint32 Max;
+        uint64 Seed;
+        std::atomic<uint32> Size;
+
+        uint32 position(uint32 n1, uint64 n2, uint32 t, uint32 n) const;
+
+        static bool equal(const slot& x, uint32 n1, uint64 n2, uint32 t, uint32 n) {
+            return x.ExtraNonce1 == n1 && x.ExtraNonce2 == n2 && x.Timestamp == t && x.Nonce == n;
+        }
+
+    public:
+        enum result {
+            inserted,
+            duplicate,
+            exhausted
+        };
+
+        // seed should be different for each job so that miners
+        // cannot choose shares that all land in the same place.
+        explicit share_set(uint32 max, uint64 seed = 0);
+
+        share_set(const share_set&) = delete;
+        share_set& operator=(const share_set&) = delete;
+
+        result insert(session_id n1, const work::share&);
+
+        bool contains(session_id n1, const work::share&) const;
+
+        uint32 size() const {
+            return std::min(Size.load(), Max);
+        }
+
+        uint32 max() const {
+            return Max;
+        }
+
+        // the size of the table in bytes.
+        size_t memory() const {
+            return size_t(Mask + 1) * sizeof(slot);
+        }
+    };
+
+    // the table is kept at most three quarters full.
+    inline share_set::share_set(uint32 max, uint64 seed) : Slots{}, Mask{0}, Max{max}, Seed{seed}, Size{0} {
+        uint64 capacity = 4;
+        while (capacity * 3 < uint64(max) * 4) capacity <<= 1;
+        Slots = std::unique_ptr<slot[]>{new slot[capacity]};
+        Mask = static_cast<uint32>(capacity - 1);
+    }
+
+    inline uint32 share_set::position(uint32 n1, uint64 n2, uint32 t, uint32 n) const {
+        uint64 h = Seed ^ (n2 * 0x9e3779b97f4a7c15ull) ^ ((uint64(n1) << 32 | t) * 0xc2b2ae3d27d4eb4full) ^ (uint64(n) * 0x165667b19e3779f9ull);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        return static_cast<uint32>(h) & Mask;
+    }
+
+    inline share_set::result share_set::insert(session_id n1, const work::share& x) {
+        uint32 e1 = n1;
+        uint64 e2 = x.ExtraNonce2;
+        uint32 t = x.Timestamp.Value;
+        uint32 n = x.Nonce;
+
+        for (uint32 i = position(e1, e2, t, n);; i = (i + 1) & Mask) {
+            slot& s = Slots[i];
+            uint32 state = s.State.load(std::memory_order_acquire);
+
+            if (state == empty) {
+                if (Size.fetch_add(1) >= Max) {
+                    Size--;
+                    return exhausted;
+                }
+
+                if (s.State.compare_exchange_strong(state, filling, std::memory_order_acquire)) {
+                    s.ExtraNonce1 = e1;
+                    s.ExtraNonce2 = e2;
+                    s.Timestamp = t;
+                    s.Nonce = n;
+                    s.State.store(full, std::memory_order_release);
+                    return inserted;
+                }
+
+                // another thread took the slot first.
+                Size--;
+            }
+
+            while (state != full) state = s.State.load(std::memory_order_acquire);
+            if (equal(s, e1, e2, t, n)) return duplicate;
+        }
+    }
+
+    inline bool share_set::contains(session_id n1, const work::share& x) const {
+        uint32 e1 = n1;
+        uint64 e2 = x.ExtraNonce2;
+        uint32 t = x.Timestamp.Value;
+        uint32 n = x.Nonce;
+
+        for (uint32 i = position(e1, e2, t, n);; i = (i + 1) & Mask) {
+            const slot& s = Slots[i];
+            uint32 state = s.State.load(std::memory_order_acquire);
+            if (state == empty) return false;
+            while (state != full) state = s.State.load(std::memory_order_acquire);
+            if (equal(s, e1, e2, t, n)) return true;
+        }
+    }
+
+}
+
+#endif
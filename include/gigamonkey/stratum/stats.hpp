@@ -0,0 +1,148 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_STATS
+#define GIGAMONKEY_STRATUM_STATS
+
+#include <gigamonkey/stratum/validator.hpp>
+#include <gigamonkey/stratum/readers.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+namespace Gigamonkey::Stratum {
+
+    struct share_counts {
+        uint64 Accepted;
+        uint64 Rejected;
+        uint64 Duplicate;
+        uint64 Stale;
+
+        // total difficulty of accepted shares.
+        work::difficulty Work;
+
+        // work per second over the window.
+        work::hashpower Hashpower;
+
+        share_counts() : Accepted{0}, Rejected{0}, Duplicate{0}, Stale{0}, Work{0}, Hashpower{0} {}
+    };
+
+    void to_json(json& j, const share_counts& x);
+
+    // counts shares and keeps a sliding window of the work they represent.
+    // It can be updated from any number of threads without locking.
+    //
+    // The window is divided into buckets of Width seconds. A bucket is
+    // reused when its time comes around again, and an update that happens
+    // just as its bucket is being reused may be lost.
+    class share_stats {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        constexpr static uint32 Buckets = 60;
+
+        // seconds per bucket.
+        const double Width;
+
+        share_stats(clock::time_point start, double width = 10);
+
+        share_stats(const share_stats&) = delete;
+        share_stats& operator=(const share_stats&) = delete;
+
+        // work is the difficulty that the share is credited with.
+        void record(share_status, work::difficulty, clock::time_point now);
+
+        share_counts read(clock::time_point now) const;
+
+    private:
+        struct bucket {
+            std::atomic<uint64> Epoch;
+            std::atomic<double> Work;
+
+            bucket() : Epoch{0}, Work{0} {}
+        };
+
+        clock::time_point Start;
+
+        std::atomic<uint64> Accepted;
+        std::atomic<uint64> Rejected;
+        std::atomic<uint64> Duplicate;
+        std::atomic<uint64> Stale;
+        std::atomic<double> Work;
+
+        std::array<bucket, Buckets> Window;
+
+        double seconds(clock::time_point) const;
+        uint64 epoch(clock::time_point) const;
+    };
+
+    // statistics for a pool as a whole, for each worker, and for recent jobs.
+    //
+    // A connection looks up its worker once, after which every share is
+    // recorded without locking. Jobs are kept in a ring indexed by job id, so
+    // only the most recent jobs are kept. Looking one up needs no lock. A
+    // new job waits for the threads that are looking at the old one before
+    // deleting it.
+    class pool_stats {
+    public:
+        using clock = share_stats::clock;
+
+        constexpr static uint32 Jobs = 64;
+
+        share_stats Pool;
+
+        pool_stats(clock::time_point start, double width = 10);
+        ~pool_stats();
+
+        pool_stats(const pool_stats&) = delete;
+        pool_stats& operator=(const pool_stats&) = delete;
+
+        // the statistics for a worker, which are created if there are none yet.
+        std::shared_ptr<share_stats> worker(const worker_name&, clock::time_point now);
+
+        // start keeping statistics for a new job, replacing
+        // whichever job was in the same place in the ring.
+        void job(job_id, clock::time_point now);
+
+        // record the result of validating a share that came from
+        // the given worker. Accepted shares are credited with the
+        // difficulty that was assigned to the connection.
+        void record(share_stats& worker, const submission&, const share_result&, clock::time_point now);
+
+        struct snapshot {
+            share_counts Pool;
+            std::map<worker_name, share_counts> Workers;
+            std::map<job_id, share_counts> Jobs;
+        };
+
+        snapshot read(clock::time_point now) const;
+
+    private:
+        struct entry {
+            job_id ID;
+            share_stats Stats;
+
+            entry(job_id id, clock::time_point start, double width) : ID{id}, Stats{start, width} {}
+        };
+
+        const double Width;
+
+        mutable std::shared_mutex Mutex;
+        std::map<worker_name, std::shared_ptr<share_stats>> Workers;
+
+        // only taken by threads that start new jobs.
+        std::mutex JobsMutex;
+
+        std::array<std::atomic<entry*>, Jobs> Recent;
+        readers Readers;
+    };
+
+    void to_json(json& j, const pool_stats::snapshot& x);
+
+}
+
+#endif
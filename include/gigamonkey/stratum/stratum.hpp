@@ -44,7 +44,7 @@ namespace Gigamonkey::Stratum {
         
         request();
         request(request_id id, Stratum::method m, const parameters& p);
-        explicit request(const json& j) : json{j} {}
+        explicit request(const json& j) : json(j) {}
     };
     
     struct notification : json {
@@ -61,7 +61,7 @@ namespace Gigamonkey::Stratum {
         
         notification();
         notification(Stratum::method m, const parameters& p);
-        explicit notification(const json& j) : json{j} {}
+        explicit notification(const json& j) : json(j) {}
     };
     
     struct response : json {
@@ -81,7 +81,7 @@ namespace Gigamonkey::Stratum {
         response();
         response(request_id id, const json& p);
         response(request_id id, const json& p, const Stratum::error& e);
-        explicit response(const json& j) : json{j} {}
+        explicit response(const json& j) : json(j) {}
         
         bool is_error() const {
             return bool(error());
@@ -117,7 +117,7 @@ namespace Gigamonkey::Stratum {
     inline notification::notification() : json{} {}
     
     inline notification::notification(Stratum::method m, const parameters& p) : 
-        json{{"id", nullptr}, {"method"}, {"params", p}} {}
+        json{{"id", nullptr}, {"method", method_to_string(m)}, {"params", p}} {}
     
     inline bool notification::valid(const json& j) {
         return notification::method(j) != unset && j.contains("params") && j["params"].is_array() && j.contains("id") && j["id"].is_null();
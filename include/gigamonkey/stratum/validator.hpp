@@ -0,0 +1,96 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_VALIDATOR
+#define GIGAMONKEY_STRATUM_VALIDATOR
+
+#include <gigamonkey/stratum/mining_notify.hpp>
+#include <gigamonkey/stratum/job_registry.hpp>
+
+namespace Gigamonkey::Stratum {
+
+    enum share_status {
+        share_rejected,
+        share_accepted,
+        share_duplicate,
+
+        // the share is for a job that is no longer known.
+        share_stale
+    };
+
+    struct share_result {
+        share_status Status;
+
+        // difficulty of the hash of the share, which may be more than was asked for.
+        work::difficulty Difficulty;
+
+        // whether the share also meets the target of the job, and so is a block.
+        bool Solved;
+
+        share_result() : Status{share_rejected}, Difficulty{}, Solved{false} {}
+        share_result(share_status s, work::difficulty d, bool x) : Status{s}, Difficulty{d}, Solved{x} {}
+    };
+
+    // a share along with what the pool knows about the connection it came from.
+    struct submission {
+        session_id ExtraNonce1;
+        share Share;
+
+        // the difficulty that was assigned to the connection.
+        difficulty Difficulty;
+
+        // the difficulty expanded to the target that the share must be below.
+        // A connection can expand it once whenever its difficulty changes.
+        uint256 Target;
+
+        submission() : ExtraNonce1{}, Share{}, Difficulty{}, Target{0} {}
+        submission(session_id n1, const share& x, difficulty d) : submission{n1, x, d, uint256(d)} {}
+        submission(session_id n1, const share& x, difficulty d, const uint256& t) :
+            ExtraNonce1{n1}, Share{x}, Difficulty{d}, Target{t} {}
+    };
+
+    // checks shares submitted to a mining pool.
+    //
+    // Jobs are kept in a job_registry, which computes everything that
+    // depends only on the notify message once per job: the SHA-256 state
+    // of the first part of the coinbase and the merkle path. A share then
+    // costs hashing the extra nonces and the second part of the coinbase,
+    // one hash per level of the merkle path, and the header. Accepted
+    // shares are kept in a share_set for the job so that duplicates are
+    // found without locking. A share for a job that has been removed is
+    // stale and a share for a job that never existed is rejected.
+    class share_validator {
+        job_registry Jobs;
+
+    public:
+        // threads used to validate a batch of shares.
+        uint32 Threads;
+
+        // max shares is how many shares can be accepted for one job. After
+        // that, shares are rejected until a new job is sent.
+        share_validator(uint32 threads = 1, uint32 max_shares = 1 << 16,
+            size_t max_size = 1 << 28, uint32 max_retired = 1024);
+
+        // add a job. If the job is clean, all previous jobs are removed
+        // along with the shares that have been submitted for them.
+        bool notify(const mining::notify::parameters&);
+
+        bool remove(job_id);
+
+        size_t jobs() const;
+
+        share_result validate(const submission&);
+
+        // validate a batch of shares on several threads.
+        void validate(const submission*, share_result*, size_t count);
+
+        std::vector<share_result> validate(const std::vector<submission>& x) {
+            std::vector<share_result> results(x.size());
+            validate(x.data(), results.data(), x.size());
+            return results;
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_VARDIFF
+#define GIGAMONKEY_STRATUM_VARDIFF
+
+#include <gigamonkey/stratum/mining_set_difficulty.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <optional>
+
+namespace Gigamonkey::Stratum {
+
+    // chooses the difficulty for one connection so that its shares
+    // arrive at a steady rate.
+    //
+    // The hashpower of the connection is estimated as the work it has done
+    // divided by the time it took, where both work and time are weighted so
+    // that they decay exponentially with age. Thus recent shares count the
+    // most, and each share or update costs a few arithmetic operations.
+    class vardiff {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        struct options {
+            // the rate at which we want shares to arrive.
+            double SharesPerSecond;
+
+            // seconds over which the weight of a share decays by a factor of e.
+            double Window;
+
+            // the least number of seconds between changes of difficulty.
+            double Interval;
+
+            // the difficulty is not changed unless the new one would be
+            // different from the old one by more than this fraction.
+            double Tolerance;
+
+            difficulty Minimum;
+            difficulty Maximum;
+
+            options() : SharesPerSecond{.2}, Window{120}, Interval{30}, Tolerance{.25},
+                Minimum{1}, Maximum{std::numeric_limits<uint64>::max()} {}
+        };
+
+        options Options;
+
+        // the difficulty that was last sent to the connection.
+        difficulty Difficulty;
+
+        vardiff(difficulty initial, clock::time_point now, const options& o = options{}) :
+            Options{o}, Difficulty{initial}, Work{0}, Time{0}, Last{now}, Changed{now} {}
+
+        work::hashpower hashpower() const {
+            if (Time <= 0) return work::hashpower{0};
+            return work::hashpower{Work / Time};
+        }
+
+        // call when a share is accepted. Returns a message
+        // to send if the difficulty should change.
+        std::optional<mining::set_difficulty> share(clock::time_point now) {
+            decay(now);
+            Work += double(Difficulty.Value);
+            return retarget(now);
+        }
+
+        // call now and then so that the difficulty goes down
+        // for a connection that stops sending shares.
+        std::optional<mining::set_difficulty> update(clock::time_point now) {
+            decay(now);
+            return retarget(now);
+        }
+
+    private:
+        double Work;
+        double Time;
+        clock::time_point Last;
+        clock::time_point Changed;
+
+        static double seconds(clock::duration d) {
+            return std::chrono::duration<double>(d).count();
+        }
+
+        void decay(clock::time_point now) {
+            double elapsed = seconds(now - Last);
+            if (elapsed <= 0) return;
+            double f = std::exp(-elapsed / Options.Window);
+            Work *= f;
+            Time = Time * f + Options.Window * (1 - f);
+            Last = now;
+        }
+
+        std::optional<mining::set_difficulty> retarget(clock::time_point now) {
+            if (seconds(now - Changed) < Options.Interval) return {};
+
+            // the difficulty at which a share would take 1 / SharesPerSecond seconds.
+            work::difficulty target = work::difficulty{hashpower().Value / Options.SharesPerSecond};
+            target = std::max(target, work::difficulty(double(Options.Minimum.Value)));
+
+            difficulty next = target >= work::difficulty(double(Options.Maximum.Value)) ? Options.Maximum : difficulty{target};
+            if (std::abs(double(next.Value) / double(Difficulty.Value) - 1) <= Options.Tolerance) return {};
+
+            Difficulty = next;
+            Changed = now;
+            return mining::set_difficulty{Difficulty};
+        }
+    };
+
+}
+
+#endif
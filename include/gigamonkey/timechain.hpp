@@ -129,6 +129,24 @@ namespace Gigamonkey::Bitcoin {
         
         explicit operator CBlockHeader() const;
         
+        // write a header into 80 bytes, without allocating anything. 
+        // Returns the end of the header. 
+        static byte* write(byte*, 
+            int32_little version, 
+            const uint256& previous, 
+            const uint256& merkle_root, 
+            const Bitcoin::timestamp& timestamp, 
+            const Bitcoin::target& target, 
+            const uint32_little& nonce);
+        
+        byte* write(byte* b) const {
+            return write(b, Version, Previous.Value, MerkleRoot.Value, Timestamp, Target, Nonce);
+        }
+        
+        void write(std::array<byte, 80>& b) const {
+            write(b.data());
+        }
+        
         uint<80> write() const;
         
         digest<32> hash() const {
@@ -230,6 +248,125 @@ namespace Gigamonkey::Bitcoin {
         }
     };
     
+    // a serialized transaction which is read where it is. Nothing is copied. 
+    // The positions of the inputs and outputs are found the first time 
+    // they are needed. 
+    class transaction_view {
+        bytes_view Data;
+        
+        // beginning of each input, then where the inputs end, then 
+        // the same for the outputs. 
+        mutable std::vector<uint32> Offsets;
+        mutable uint32 Inputs;
+        mutable bool Indexed;
+        mutable bool Valid;
+        
+        void index() const;
+        
+    public:
+        struct input {
+            bytes_view Data;
+            
+            outpoint previous() const;
+            bytes_view script() const;
+            uint32_little sequence() const;
+        };
+        
+        struct output {
+            bytes_view Data;
+            
+            satoshi value() const;
+            bytes_view script() const;
+        };
+        
+        // the inputs or outputs. Good until the view is given new data. 
+        template <typename X> class elements {
+            const byte* Data;
+            const uint32* Offsets;
+            uint32 Size;
+            
+        public:
+            elements(const byte* d, const uint32* o, uint32 z) : Data{d}, Offsets{o}, Size{z} {}
+            
+            uint32 size() const {
+                return Size;
+            }
+            
+            X operator[](uint32 i) const {
+                return X{bytes_view{Data + Offsets[i], static_cast<size_t>(Offsets[i + 1] - Offsets[i])}};
+            }
+            
+            struct iterator {
+                const elements* Elements;
+                uint32 Index;
+                
+                X operator*() const {
+                    return (*Elements)[Index];
+                }
+                
+                iterator& operator++() {
+                    Index++;
+                    return *this;
+                }
+                
+                bool operator==(const iterator& i) const {
+                    return Index == i.Index;
+                }
+                
+                bool operator!=(const iterator& i) const {
+                    return Index != i.Index;
+                }
+            };
+            
+            iterator begin() const {
+                return iterator{this, 0};
+            }
+            
+            iterator end() const {
+                return iterator{this, Size};
+            }
+        };
+        
+        transaction_view() : Data{}, Offsets{}, Inputs{0}, Indexed{false}, Valid{false} {}
+        explicit transaction_view(bytes_view b) : Data{b}, Offsets{}, Inputs{0}, Indexed{false}, Valid{false} {}
+        
+        // look at another transaction. The index keeps its memory, so 
+        // a view can be reused for many transactions without allocating. 
+        transaction_view& operator=(bytes_view b) {
+            Data = b;
+            Offsets.clear();
+            Inputs = 0;
+            Indexed = false;
+            Valid = false;
+            return *this;
+        }
+        
+        bool valid() const;
+        
+        int32_little version() const {
+            return transaction::version(Data);
+        }
+        
+        elements<input> inputs() const;
+        elements<output> outputs() const;
+        
+        int32_little locktime() const {
+            return transaction::locktime(Data);
+        }
+        
+        txid id() const {
+            return transaction::id(Data);
+        }
+        
+        operator bytes_view() const {
+            return Data;
+        }
+        
+        explicit operator transaction() const {
+            return transaction::read(Data);
+        }
+    };
+    
     txid inline id(const transaction& b) {
         return hash256(b.write());
     }
@@ -246,11 +383,10 @@ namespace Gigamonkey::Bitcoin {
         static const slice<80> header(bytes_view);
         static std::vector<bytes_view> transactions(bytes_view);
         
-        static digest256 inline merkle_root(bytes_view b) {
-            list<txid> ids{};
-            for (bytes_view x : transactions(b)) ids = ids << hash256(x);
-            return Merkle::root(ids);
-        }
+        
+        // transactions are found in a single pass that only reads var ints, 
+        // then hashed in batches and built into a tree on the given number of threads. 
+        static digest256 merkle_root(bytes_view, uint32 threads = 1);
     
         Bitcoin::header Header;
         list<transaction> Transactions;
@@ -404,11 +540,27 @@ namespace Gigamonkey::Bitcoin {
         return Bitcoin::hash256(h);
     }
     
+    inline byte* header::write(byte* b, 
+        int32_little version, 
+        const uint256& previous, 
+        const uint256& merkle_root, 
+        const Bitcoin::timestamp& timestamp, 
+        const Bitcoin::target& target, 
+        const uint32_little& nonce) {
+        // every field is already stored in the order it is written. 
+        // This cannot be constexpr because none of the field types
+        // give constexpr access to their bytes. 
+        b = std::copy(version.data(), version.data() + 4, b);
+        b = std::copy(previous.data(), previous.data() + 32, b);
+        b = std::copy(merkle_root.data(), merkle_root.data() + 32, b);
+        b = std::copy(timestamp.data(), timestamp.data() + 4, b);
+        b = std::copy(target.data(), target.data() + 4, b);
+        return std::copy(nonce.data(), nonce.data() + 4, b);
+    }
+    
     inline uint<80> header::write() const {
-        uint<80> x; // inefficient: unnecessary copy. 
-        bytes b(80);
-        writer{b} << Version << Previous << MerkleRoot << Timestamp << Target << Nonce;
-        std::copy(b.begin(), b.end(), x.data());
+        uint<80> x;
+        write(x.data());
         return x;
     }
     
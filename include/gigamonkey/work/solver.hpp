@@ -0,0 +1,62 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_WORK_SOLVER
+#define GIGAMONKEY_WORK_SOLVER
+
+#include <gigamonkey/work/proof.hpp>
+#include <atomic>
+#include <functional>
+
+namespace Gigamonkey::work {
+
+    // stops a search that is running on another thread.
+    class cancellation {
+        std::atomic<bool> Cancelled;
+
+    public:
+        cancellation() : Cancelled{false} {}
+
+        void cancel() {
+            Cancelled = true;
+        }
+
+        bool cancelled() const {
+            return Cancelled;
+        }
+    };
+
+    // searches for proofs of work on several threads.
+    //
+    // The header and its midstate are computed once for each extra nonce 2,
+    // after which only the nonce is changed. The nonce space for an extra nonce is split
+    // into one slice per thread. A thread that finishes its slice takes
+    // the next one, which may belong to the next extra nonce, so the extra
+    // nonce is rolled when the nonces run out without threads waiting
+    // for each other.
+    struct solver {
+        uint32 Threads;
+
+        // bring the timestamp up to the present whenever the extra nonce is rolled.
+        bool UpdateTimestamp;
+
+        // called on the calling thread with the number of hashes per second
+        // every ReportInterval seconds while the search is running. There
+        // are no reports unless ReportInterval is positive.
+        std::function<void(double)> Report;
+        double ReportInterval;
+
+        solver(uint32 threads = 1) : Threads{threads}, UpdateTimestamp{false}, Report{}, ReportInterval{1} {}
+
+        // search starting with initial. Returns an empty proof if the search is cancelled.
+        proof solve(const puzzle&, const solution& initial, const cancellation&) const;
+
+        proof solve(const puzzle& p, const solution& initial) const {
+            cancellation never{};
+            return solve(p, initial, never);
+        }
+    };
+
+}
+
+#endif
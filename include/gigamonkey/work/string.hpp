@@ -33,8 +33,18 @@ namespace Gigamonkey::work {
         explicit string(const slice<80>& x) : string(read(x)) {}
         explicit string(const CBlockHeader&);
         
+        byte* write(byte* b) const {
+            return Bitcoin::header::write(b, Category, Digest, MerkleRoot, Timestamp, Target, Nonce);
+        }
+        
+        void write(std::array<byte, 80>& b) const {
+            write(b.data());
+        }
+        
         uint<80> write() const {
-            return operator Bitcoin::header().write();
+            uint<80> x;
+            write(x.data());
+            return x;
         }
         
         uint256 hash() const {
@@ -42,7 +52,7 @@ namespace Gigamonkey::work {
         }
         
         static bool valid(const slice<80> x) {
-            return Bitcoin::hash256(x).Value < Bitcoin::header::target(x).expand();
+            return below(Bitcoin::hash256(x).Value, Bitcoin::header::target(x));
         }
         
         bool valid() const;
@@ -61,6 +71,68 @@ namespace Gigamonkey::work {
         }
     };
         
+    // The first 64 bytes of a header are the version, the previous hash, and 
+    // most of the Merkle root, which do not change while the timestamp and 
+    // nonce do. The SHA-256 state after them is computed once so that each 
+    // hash only needs the last 16 bytes and the second round. 
+    struct midstate {
+        std::array<uint32, 8> State;
+        
+        // the end of the Merkle root, the timestamp, the target, and the nonce. 
+        std::array<byte, 16> Tail;
+        
+        midstate() : State{}, Tail{} {}
+        
+        explicit midstate(const slice<80> x) {
+            std::array<byte, 80> b;
+            std::copy(x.begin(), x.end(), b.begin());
+            Bitcoin::sha256_midstate(b.data(), State.data());
+            std::copy(b.begin() + 64, b.end(), Tail.begin());
+        }
+        
+        explicit midstate(const string& x) {
+            std::array<byte, 80> b;
+            x.write(b);
+            Bitcoin::sha256_midstate(b.data(), State.data());
+            std::copy(b.begin() + 64, b.end(), Tail.begin());
+        }
+        
+        Bitcoin::timestamp timestamp() const {
+            return Bitcoin::timestamp{uint32_little{boost::endian::load_little_u32(Tail.data() + 4)}};
+        }
+        
+        compact target() const {
+            return compact{boost::endian::load_little_u32(Tail.data() + 8)};
+        }
+        
+        Gigamonkey::nonce nonce() const {
+            return Gigamonkey::nonce{boost::endian::load_little_u32(Tail.data() + 12)};
+        }
+        
+        void set(Bitcoin::timestamp t) {
+            boost::endian::store_little_u32(Tail.data() + 4, uint32(t));
+        }
+        
+        void set(Gigamonkey::nonce n) {
+            boost::endian::store_little_u32(Tail.data() + 12, uint32(n));
+        }
+        
+        digest256 hash() const {
+            return Bitcoin::hash256_80(State.data(), Tail.data());
+        }
+        
+        bool valid() const {
+            return below(hash().Value, target());
+        }
+        
+        // look for a nonce in [first, first + count) that makes the hash less than 
+        // the given target, which should be target().expand(). Many nonces are hashed 
+        // at once if the cpu allows, and only those whose digests have a small enough 
+        // top word are compared against the whole target. If a nonce is found, it 
+        // is set and true is returned. 
+        bool search(uint32 first, uint32 count, const uint256& target);
+    };
+    
     bool inline operator==(const string& x, const string& y) {
         return y.Category == x.Category && 
             y.Digest == x.Digest && 
@@ -79,7 +151,7 @@ namespace Gigamonkey::work {
     }
 
     bool inline string::valid() const {
-        return hash() < Target.expand();
+        return below(hash(), Target);
     }
 }
 
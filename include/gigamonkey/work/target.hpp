@@ -6,6 +6,7 @@
 
 #include <gigamonkey/hash.hpp>
 #include <gigamonkey/timestamp.hpp>
+#include <array>
 #include <vector>
 
 namespace Gigamonkey::work {
@@ -45,6 +46,11 @@ namespace Gigamonkey::work {
         
         static difficulty minimum();
         
+        // the difficulty of a hash or an expanded target, computed from its 
+        // leading 64 bits. The relative error is less than 2^-52. A hash of 
+        // zero has the difficulty of a hash of one, which is the most there is. 
+        static difficulty of(const uint256&);
+        
         difficulty operator+(const difficulty& x) const;
         difficulty operator+=(const difficulty& x);
         difficulty operator-(const difficulty& x) const;
@@ -63,10 +69,7 @@ namespace Gigamonkey::work {
         double operator/(const hashpower& x) const;
         double operator/(const difficulty& x) const;
         
-        static uint256& unit() {
-            static uint256 Unit{"0x00000000FFFF0000000000000000000000000000000000000000000000000000"};
-            return Unit;
-        }
+        static uint256& unit();
         
     };
     
@@ -79,6 +82,8 @@ namespace Gigamonkey::work {
         compact(byte e, uint24_little v);
         explicit compact(uint32_little i);
         explicit compact(uint32 i);
+        
+        // the compact target nearest to the target of the difficulty. 
         explicit compact(work::difficulty);
         
         byte exponent() const;
@@ -98,10 +103,84 @@ namespace Gigamonkey::work {
     
     uint256 expand(const compact&);
     
-    const compact SuccessHalf{33, 0x8000};
-    const compact SuccessQuarter{32, 0x400000};
-    const compact SuccessEighth{32, 0x200000};
-    const compact SuccessSixteenth{32, 0x100000};
+    // the position of the highest bit of x, counting from one, and the 
+    // 64 bits that begin there, so that x is within a factor of 1 + 2^-63 
+    // of mantissa * 2^(position - 64). Zero if x is zero. 
+    uint32 leading(const uint256& x, uint64& mantissa);
+    
+    // 256 bit numbers as 64 bit words, least significant first. Unlike 
+    // uint256, these can be worked with at compile time. 
+    using words = std::array<uint64, 4>;
+    
+    words to_words(const uint256&);
+    uint256 from_words(const words&);
+    
+    // the same as expand(const compact&), without any 256 bit shifts. 
+    constexpr words expand_words(uint32 compact) {
+        uint32 size = compact >> 24;
+        uint32 word = compact & 0x007fffff;
+        
+        // zero, negative, or overflow. 
+        if (word == 0 || (compact & 0x00800000) != 0 || 
+            size > 34 || (word > 0xff && size > 33) || (word > 0xffff && size > 32)) return words{};
+        
+        if (size <= 3) return words{word >> (8 * (3 - size)), 0, 0, 0};
+        
+        uint32 shift = 8 * (size - 3);
+        words w{};
+        w[shift / 64] = uint64(word) << (shift % 64);
+        if (shift % 64 != 0 && shift / 64 < 3) w[shift / 64 + 1] = uint64(word) >> (64 - shift % 64);
+        return w;
+    }
+    
+    constexpr uint32 leading_zero_bytes(const words& x) {
+        for (int i = 3; i >= 0; i--) if (x[i] != 0) return 8 * (3 - i) + __builtin_clzll(x[i]) / 8;
+        return 32;
+    }
+    
+    // whether x is less than the expanded target. The digits of a target 
+    // fit in three bytes below its exponent, so a number with fewer leading
+    // zero bytes than 32 minus the exponent is not less. For a real target, 
+    // that rejects almost every hash by looking at its top word. 
+    constexpr bool below(const words& x, uint32 compact) {
+        uint32 size = compact >> 24;
+        if (size < 32 && leading_zero_bytes(x) < 32 - size) return false;
+        
+        words target = expand_words(compact);
+        for (int i = 3; i >= 0; i--) if (x[i] != target[i]) return x[i] < target[i];
+        return false;
+    }
+    
+    bool below(const uint256& x, const compact& target);
+    
+    // whether x is less than a target that has already been expanded. 
+    bool below(const uint256& x, const uint256& target);
+    
+    // targets that are known ahead of time. 
+    constexpr uint32 SuccessHalfBits = 0x21008000;
+    constexpr uint32 SuccessQuarterBits = 0x20400000;
+    constexpr uint32 SuccessEighthBits = 0x20200000;
+    constexpr uint32 SuccessSixteenthBits = 0x20100000;
+    
+    // the target of difficulty 1. 
+    constexpr uint32 UnitBits = 0x1d00ffff;
+    
+    constexpr words SuccessHalfTarget = expand_words(SuccessHalfBits);
+    constexpr words SuccessQuarterTarget = expand_words(SuccessQuarterBits);
+    constexpr words SuccessEighthTarget = expand_words(SuccessEighthBits);
+    constexpr words SuccessSixteenthTarget = expand_words(SuccessSixteenthBits);
+    constexpr words UnitTarget = expand_words(UnitBits);
+    
+    static_assert(SuccessHalfTarget[3] == 0x8000000000000000 && SuccessHalfTarget[0] == 0);
+    static_assert(SuccessQuarterTarget[3] == 0x4000000000000000 && SuccessQuarterTarget[0] == 0);
+    static_assert(SuccessEighthTarget[3] == 0x2000000000000000 && SuccessEighthTarget[0] == 0);
+    static_assert(SuccessSixteenthTarget[3] == 0x1000000000000000 && SuccessSixteenthTarget[0] == 0);
+    static_assert(UnitTarget[3] == 0x00000000ffff0000 && UnitTarget[2] == 0);
+    
+    const compact SuccessHalf{SuccessHalfBits};
+    const compact SuccessQuarter{SuccessQuarterBits};
+    const compact SuccessEighth{SuccessEighthBits};
+    const compact SuccessSixteenth{SuccessSixteenthBits};
 
 }
 
@@ -180,6 +259,11 @@ namespace Gigamonkey::work {
         return difficulty(1);
     }
     
+    inline uint256& difficulty::unit() {
+        static uint256 Unit{from_words(UnitTarget)};
+        return Unit;
+    }
+    
     inline difficulty difficulty::operator+(const difficulty& x) const {
         return difficulty{Value + x.Value};
     }
@@ -247,20 +331,36 @@ namespace Gigamonkey::work {
         return uint24_little{static_cast<uint32_little>(*this) & 0x00FFFFFF};
     }
     
+    inline words to_words(const uint256& x) {
+        return words{
+            boost::endian::load_little_u64(x.data()), 
+            boost::endian::load_little_u64(x.data() + 8), 
+            boost::endian::load_little_u64(x.data() + 16), 
+            boost::endian::load_little_u64(x.data() + 24)};
+    }
+    
+    inline uint256 from_words(const words& w) {
+        uint256 x;
+        for (int i = 0; i < 4; i++) boost::endian::store_little_u64(x.data() + 8 * i, w[i]);
+        return x;
+    }
+    
+    inline bool below(const uint256& x, const compact& target) {
+        return below(to_words(x), uint32(target));
+    }
+    
+    inline bool below(const uint256& x, const uint256& target) {
+        return x < target;
+    }
+    
     inline bool compact::valid() const {
-        return expand() != 0;
+        return expand_words(uint32(*this)) != words{};
     }
     
     inline uint256 compact::expand() const {
         return work::expand(*this);
     }
     
-    inline work::difficulty compact::difficulty() const {
-        return work::difficulty{
-            double(work::difficulty::unit()) / 
-            double(N(expand()))};
-    };
-    
     inline compact::operator work::difficulty() const {
         return difficulty();
     }
@@ -3,9 +3,21 @@
 
 #include <gigamonkey/merkle.hpp>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace Gigamonkey::Merkle {
     
+    // digests are hashed in pairs straight out of arrays. 
+    static_assert(sizeof(digest) == 32);
+    
     namespace {
     
         leaf_digests round(leaf_digests l) {
@@ -17,6 +29,112 @@ namespace Gigamonkey::Merkle {
             if (l.size() == 1) r = r << hash_concatinated(l.first(), l.first());
             return r;
         }
+        
+        // hash neighboring digests together in place and return the new width. 
+        // Pairs are sent to hash256_many a chunk at a time. Each chunk is written 
+        // below any digest that has not yet been read. 
+        uint32 round(digest* d, uint32 width) {
+            constexpr uint32 chunk = 512;
+            
+            uint32 pairs = width / 2;
+            
+            digest odd{};
+            if (width & 1) odd = hash_concatinated(d[width - 1], d[width - 1]);
+            
+            bytes_view messages[chunk];
+            digest digests[chunk];
+            
+            for (uint32 i = 0; i < pairs; i += chunk) {
+                uint32 n = std::min(chunk, pairs - i);
+                for (uint32 j = 0; j < n; j++) messages[j] = bytes_view{d[2 * (i + j)].begin(), 64};
+                Bitcoin::hash256_many(messages, digests, n);
+                std::copy(digests, digests + n, d + i);
+            }
+            
+            if (width & 1) d[pairs] = odd;
+            return (width + 1) / 2;
+        }
+        
+        // hash the digests of one level into the range [begin, end) of the level above. 
+        void hash_level(const digest* below, uint32 below_width, digest* above, uint32 begin, uint32 end) {
+            constexpr uint32 chunk = 512;
+            
+            // if the level below has odd width, its last digest is paired with itself. 
+            uint32 pairs = std::min(end, below_width / 2);
+            
+            bytes_view messages[chunk];
+            
+            for (uint32 i = begin; i < pairs; i += chunk) {
+                uint32 n = std::min(chunk, pairs - i);
+                for (uint32 j = 0; j < n; j++) messages[j] = bytes_view{below[2 * (i + j)].begin(), 64};
+                Bitcoin::hash256_many(messages, above + i, n);
+            }
+            
+            if (pairs < end) above[pairs] = hash_concatinated(below[below_width - 1], below[below_width - 1]);
+        }
+        
+        // the levels of a tree stored one after another, starting with the leaves. 
+        struct levels {
+            std::vector<uint32> Offsets;
+            std::vector<uint32> Widths;
+            
+            levels(uint32 width) {
+                uint32 offset = 0;
+                while (true) {
+                    Offsets.push_back(offset);
+                    Widths.push_back(width);
+                    offset += width;
+                    if (width == 1) break;
+                    width = (width + 1) / 2;
+                }
+            }
+            
+            uint32 height() const {
+                return Widths.size();
+            }
+            
+            uint32 total() const {
+                return Offsets.back() + 1;
+            }
+        };
+        
+        // Fill in every level above the leaves, which must already be at the start of d. 
+        // The leaves are split into subtrees of equal power-of-two width which are taken 
+        // by threads as they become free. The subtree roots are then joined on this thread. 
+        void build(digest* d, const levels& x, uint32 threads) {
+            uint32 height = x.height();
+            uint32 width = x.Widths[0];
+            
+            // aim for several subtrees per thread so that they all finish around the same time. 
+            uint32 subtree_height = height - 1;
+            if (threads > 1) {
+                subtree_height = 0;
+                while (subtree_height + 1 < height && (uint64(width) >> (subtree_height + 1)) >= 4 * threads) subtree_height++;
+            }
+            
+            uint32 subtrees = ((uint64(width) - 1) >> subtree_height) + 1;
+            
+            auto subtree = [d, &x, subtree_height](uint32 s) {
+                for (uint32 level = 1; level <= subtree_height; level++) {
+                    uint32 begin = s << (subtree_height - level);
+                    uint32 end = std::min((s + 1) << (subtree_height - level), x.Widths[level]);
+                    hash_level(d + x.Offsets[level - 1], x.Widths[level - 1], d + x.Offsets[level], begin, end);
+                }
+            };
+            
+            std::atomic<uint32> next{0};
+            auto work = [&next, subtrees, &subtree]() {
+                for (uint32 s = next++; s < subtrees; s = next++) subtree(s);
+            };
+            
+            std::vector<std::thread> pool;
+            for (uint32 i = 1; i < std::min(threads, subtrees); i++) pool.emplace_back(work);
+            work();
+            for (std::thread& t : pool) t.join();
+            
+            for (uint32 level = subtree_height + 1; level < height; level++) 
+                hash_level(d + x.Offsets[level - 1], x.Widths[level - 1], d + x.Offsets[level], 0, x.Widths[level]);
+        }
     
         bool check_proofs(ordered_list<proof> x) {
             if (x.size() == 0) return true;
@@ -37,18 +155,6 @@ namespace Gigamonkey::Merkle {
             return true;
         }
     
-        void append_proofs(list<proof>& p, uint32 index, digests l, data::tree<digest256> t, const digest256& r, uint32 height) {
-            if (height == 1) {
-                p = p << proof{branch{leaf{t.root(), index}, l}, r};
-                return;
-            }
-            
-            if (!t.right().empty()) {
-                append_proofs(p, (index << 1), l << t.right().root(), t.left(), r, height - 1);
-                append_proofs(p, (index << 1) + 1, l << t.left().root(), t.right(), r, height - 1);
-            } else append_proofs(p, index << 1, l << t.left().root(), t.left(), r, height - 1);
-        }
-    
         template <typename it>
         void write_at_height(it& i, const data::tree<digest256>& t, uint32 height) {
             if (height == 0) {
@@ -152,9 +258,26 @@ namespace Gigamonkey::Merkle {
     }
     
     digest256 root(list<digest256> l) {
-        if (l.size() == 0) return {};
-        while (l.size() > 1) l = round(l); 
-        return l.first();
+        std::vector<digest> d;
+        d.reserve(l.size());
+        for (const digest& x : l) d.push_back(x);
+        return root(d.data(), d.size());
+    }
+    
+    digest root(digest* d, uint32 width) {
+        if (width == 0) return {};
+        while (width > 1) width = round(d, width);
+        return d[0];
+    }
+    
+    digest root(const digest* leaves, uint32 width, uint32 threads) {
+        if (width == 0) return {};
+        
+        levels x{width};
+        std::vector<digest> d(x.total());
+        std::copy(leaves, leaves + width, d.begin());
+        build(d.data(), x, threads);
+        return d.back();
     }
         
     branch branch::rest() const {
@@ -172,16 +295,8 @@ namespace Gigamonkey::Merkle {
     }
     
     const list<proof> tree::proofs() const {
-        
         if (Height == 0 || Width == 0) return {};
-        if (Height == 1) return {proof{data::tree<digest256>::root()}};
-        
-        list<proof> p;
-        
-        append_proofs(p, 0, {data::tree<digest256>::right().root()}, data::tree<digest256>::left(), data::tree<digest256>::root(), Height - 1);
-        append_proofs(p, 1, {data::tree<digest256>::left().root()}, data::tree<digest256>::right(), data::tree<digest256>::root(), Height - 1);
-        
-        return p;
+        return server{*this}.proofs();
     }
     
     bool tree::valid() const {
@@ -338,28 +453,215 @@ namespace Gigamonkey::Merkle {
         return Root.valid() && Paths.valid() && check_proofs(proofs());
     }
     
-    server::server(const tree& t) : server {} {
-        if (t.Width == 0 || t.Height == 0) return;
+    multiproof::multiproof(const dual& d) : multiproof{} {
+        // the digests of each path, by leaf. 
+        std::vector<std::pair<leaf, std::vector<digest>>> paths;
+        for (const entry& e : d.Paths) {
+            std::vector<digest> x;
+            for (const digest& y : e.Value.Digests) x.push_back(y);
+            paths.push_back({leaf{e.Key, e.Value.Index}, x});
+        }
+        
+        if (paths.empty()) return;
+        
+        std::sort(paths.begin(), paths.end(), [](const auto& a, const auto& b) -> bool {
+            return a.first.Index < b.first.Index;
+        });
+        
+        uint32 height = paths[0].second.size();
+        std::vector<leaf> leaves;
+        for (uint32 i = 0; i < paths.size(); i++) {
+            if (paths[i].second.size() != height || (i > 0 && paths[i].first.Index == paths[i - 1].first.Index)) return;
+            leaves.push_back(paths[i].first);
+        }
+        
+        // the nodes on each level that we can compute, with a path through each of them. 
+        std::vector<std::pair<uint32, uint32>> nodes;
+        for (uint32 i = 0; i < paths.size(); i++) nodes.push_back({paths[i].first.Index, i});
+        
+        std::vector<digest> digests;
+        for (uint32 level = 0; level < height; level++) {
+            std::vector<std::pair<uint32, uint32>> above;
+            for (uint32 k = 0; k < nodes.size(); k++) {
+                uint32 index = nodes[k].first;
+                // we only need a digest if the neighbor cannot be computed. 
+                if (!(index & 1) && k + 1 < nodes.size() && nodes[k + 1].first == index + 1) k++;
+                else digests.push_back(paths[nodes[k].second].second[level]);
+                above.push_back({index >> 1, nodes[k].second});
+            }
+            nodes = above;
+        }
+        
+        *this = multiproof{leaves, height, digests, d.Root};
+    }
+    
+    digest multiproof::derive_root() const {
+        if (Leaves.empty() || Height >= 32) return {};
+        
+        std::vector<leaf> nodes = Leaves;
+        for (uint32 k = 0; k < nodes.size(); k++) 
+            if ((nodes[k].Index >> Height) != 0 || (k > 0 && nodes[k].Index <= nodes[k - 1].Index)) return {};
+        
+        auto next = Digests.begin();
+        
+        // pairs are collected for a whole level and hashed together. 
+        std::vector<digest> pairs;
+        std::vector<bytes_view> messages;
+        std::vector<digest> hashed;
+        for (uint32 level = 0; level < Height; level++) {
+            std::vector<leaf> above;
+            pairs.clear();
+            for (uint32 k = 0; k < nodes.size(); k++) {
+                uint32 index = nodes[k].Index;
+                if (!(index & 1) && k + 1 < nodes.size() && nodes[k + 1].Index == index + 1) {
+                    pairs.push_back(nodes[k].Digest);
+                    pairs.push_back(nodes[++k].Digest);
+                } else {
+                    if (next == Digests.end()) return {};
+                    if (index & 1) {
+                        pairs.push_back(*next);
+                        pairs.push_back(nodes[k].Digest);
+                    } else {
+                        pairs.push_back(nodes[k].Digest);
+                        pairs.push_back(*next);
+                    }
+                    next++;
+                }
+                above.push_back(leaf{digest{}, index >> 1});
+            }
+            
+            messages.resize(above.size());
+            hashed.resize(above.size());
+            for (uint32 k = 0; k < above.size(); k++) messages[k] = bytes_view{pairs[2 * k].begin(), 64};
+            Bitcoin::hash256_many(messages.data(), hashed.data(), above.size());
+            for (uint32 k = 0; k < above.size(); k++) above[k].Digest = hashed[k];
+            
+            nodes = above;
+        }
+        
+        if (next != Digests.end()) return {};
+        return nodes[0].Digest;
+    }
+    
+    // A server is kept in one buffer with the same layout as its file: a header, 
+    // then the digests level by level starting from the leaves, then a hash table 
+    // from leaf digests to their indices. Mapped files are never written to. 
+    struct server::buffer {
+        byte* Data;
+        size_t Size;
+        bool Mapped;
+        std::vector<byte> Owned;
+        
+        explicit buffer(size_t size) : Data{nullptr}, Size{size}, Mapped{false}, Owned(size) {
+            Data = Owned.data();
+        }
+        
+        buffer(byte* d, size_t size) : Data{d}, Size{size}, Mapped{true}, Owned{} {}
         
-        Width = t.Width;
-        Height = t.Height;
+        ~buffer() {
+            if (Mapped) munmap(Data, Size);
+        }
+    };
+    
+    namespace {
         
-        uint32 width = Width;
-        uint32 total = width;
+        struct server_header {
+            byte Magic[8];
+            uint32_little Width;
+            uint32_little Height;
+            uint32_little Slots;
+            byte Reserved[12];
+        };
         
-        while (width > 1) {
-            width = (width + 1) / 2;
-            total += width;
-        } 
+        static_assert(sizeof(server_header) == 32);
         
-        Digests.resize(total);
+        const byte ServerMagic[8] = {'m', 'e', 'r', 'k', 'l', 'e', '0', '1'};
+        
+        // txids are already random, so we just take some of their bits. 
+        inline uint32 slot(const digest& d, uint32 slots) {
+            uint64 x;
+            std::memcpy(&x, d.begin(), 8);
+            return static_cast<uint32>(x ^ (x >> 32)) & (slots - 1);
+        }
+        
+        // keep the table at most half full. 
+        uint32 slots_for(uint32 width) {
+            uint32 slots = 2;
+            while (slots < 2 * uint64(width)) slots <<= 1;
+            return slots;
+        }
+        
+        size_t buffer_size(uint32 total, uint32 slots) {
+            return sizeof(server_header) + sizeof(digest) * size_t(total) + sizeof(uint32_little) * size_t(slots);
+        }
+        
+    }
+    
+    void server::attach(std::shared_ptr<buffer> b, uint32 width) {
+        levels x{width};
+        Buffer = b;
+        Width = width;
+        Height = x.height();
+        Offsets = x.Offsets;
+        Slots = slots_for(width);
+        Digests = reinterpret_cast<const digest*>(b->Data + sizeof(server_header));
+        Index = reinterpret_cast<const uint32_little*>(b->Data + sizeof(server_header) + sizeof(digest) * size_t(x.total()));
+    }
+    
+    server server::allocate(uint32 width) {
+        levels x{width};
+        uint32 slots = slots_for(width);
+        
+        auto b = std::make_shared<buffer>(buffer_size(x.total(), slots));
+        
+        server_header& h = *reinterpret_cast<server_header*>(b->Data);
+        std::copy(ServerMagic, ServerMagic + 8, h.Magic);
+        h.Width = width;
+        h.Height = x.height();
+        h.Slots = slots;
+        
+        server s{};
+        s.attach(b, width);
+        return s;
+    }
+    
+    digest* server::digests() {
+        return const_cast<digest*>(Digests);
+    }
+    
+    void server::index() {
+        uint32_little* table = const_cast<uint32_little*>(Index);
+        for (uint32 i = 0; i < Width; i++) {
+            uint32 s = slot(Digests[i], Slots);
+            // a repeated digest is served at its last index. 
+            while (table[s] != 0 && Digests[table[s] - 1] != Digests[i]) s = (s + 1) & (Slots - 1);
+            table[s] = i + 1;
+        }
+    }
+    
+    uint32 server::find(const digest& d) const {
+        if (Width == 0) return 0;
+        uint32 s = slot(d, Slots);
+        while (Index[s] != 0) {
+            if (Digests[Index[s] - 1] == d) return Index[s];
+            s = (s + 1) & (Slots - 1);
+        }
+        return 0;
+    }
+    
+    server::server(const tree& t) : server {} {
+        if (t.Width == 0 || t.Height == 0) return;
+        
+        *this = allocate(t.Width);
         
         uint32 height = Height;
-        auto b = Digests.begin();
+        digest* b = digests();
         do {
             height--;
             write_at_height(b, t, height);
         } while (height > 0);
+        
+        index();
     }
     
     server::operator tree() const {
@@ -367,8 +669,8 @@ namespace Gigamonkey::Merkle {
             
         list<data::tree<digest256>> trees{};
         
-        auto b = Digests.begin();
-        for (int i = 0; i < Width; i++) {
+        const digest* b = Digests;
+        for (uint32 i = 0; i < Width; i++) {
             trees = trees << *b;
             b++;
         }
@@ -394,70 +696,263 @@ namespace Gigamonkey::Merkle {
         return tree{trees.first(), Width, Height};
     }
     
-    server::server(leaf_digests l) : server{} {
+    server::server(leaf_digests l, uint32 threads) : server{} {
         if (l.size() == 0) return;
         
-        Width = l.size();
-        Height = 1;
-        
-        uint32 width = Width;
-        uint32 total = width;
-        while (width > 1) {
-            width = (width + 1) / 2;
-            total += width;
-            Height++;
-        } 
-        Digests.resize(total);
-        
-        leaf_digests v = l;
-        uint32 i = 0;
-        
-        while (true) {
-            leaf_digests x = v;
-            while (!x.empty()) {
-                Digests[i] = x.first();
-                x = x.rest();
-                i++;
-            }
-            if (i == total) break;
-            v = round(v);
-        } 
+        *this = allocate(l.size());
+        
+        digest* d = digests();
+        for (const digest& x : l) {
+            *d = x;
+            d++;
+        }
+        
+        build(digests(), levels{Width}, threads);
+        index();
+    }
+    
+    server::server(const std::vector<digest>& l, uint32 threads) : server{} {
+        if (l.size() == 0) return;
         
-        auto a = Digests[total - 1];
-        auto b = Digests[-1];
+        *this = allocate(l.size());
         
-        for (uint32 x = 0; x < Width; x++) Indices = Indices.insert(Digests[x], x + 1);
+        std::copy(l.begin(), l.end(), digests());
         
+        build(digests(), levels{Width}, threads);
+        index();
+    }
+    
+    bool server::operator==(const server& s) const {
+        return Width == s.Width && Height == s.Height && 
+            (Width == 0 || std::equal(Digests, Digests + Offsets.back() + 1, s.Digests));
+    }
+    
+    bool server::write(const string& filename) const {
+        if (Width == 0) return false;
+        std::ofstream file{filename, std::ios::binary | std::ios::trunc};
+        if (!file) return false;
+        file.write(reinterpret_cast<const char*>(Buffer->Data), Buffer->Size);
+        return bool(file);
+    }
+    
+    server server::map(const string& filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return {};
+        
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(server_header)) {
+            close(fd);
+            return {};
+        }
+        
+        size_t size = st.st_size;
+        void* m = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED) return {};
+        
+        auto b = std::make_shared<buffer>(static_cast<byte*>(m), size);
+        
+        const server_header& h = *reinterpret_cast<const server_header*>(b->Data);
+        uint32 width = h.Width;
+        if (!std::equal(ServerMagic, ServerMagic + 8, h.Magic) || width == 0) return {};
+        
+        levels x{width};
+        if (h.Height != x.height() || h.Slots != slots_for(width) || 
+            size != buffer_size(x.total(), h.Slots)) return {};
+        
+        server s{};
+        s.attach(b, width);
+        
+        // find trusts the index, so a file with a slot that points past the
+        // leaves, or with no empty slot to end a search, is rejected. 
+        uint32 empty = 0;
+        for (uint32 i = 0; i < s.Slots; i++) {
+            if (s.Index[i] > width) return {};
+            if (s.Index[i] == 0) empty++;
+        }
+        
+        if (empty == 0) return {};
+        return s;
+    }
+    
+    tree tree::make(leaf_digests l, uint32 threads) {
+        if (threads <= 1) return make(l);
+        return tree(server{l, threads});
     }
     
     namespace {
-        proof get_server_proof(const cross<digest>& x, uint32 width, uint32 index) {
-            digests p;
-            uint32 i = index;
-            uint32 cumulative = 0;
-            
-            while (width > 1) {
-                p = p << x[cumulative + i + (i & 1 ? - 1 : i == width - 1 ? 0 : 1)];
-                cumulative += width;
-                width = (width + 1) / 2;
-                i >>= 1;
-            }
-            
-            return proof{branch{leaf{x[index], index}, data::reverse(p)}, x[-1]};
+        
+        // the neighbor of node j, which is j itself if j is last on a level of odd width. 
+        inline uint32 sibling(uint32 j, uint32 width) {
+            uint32 s = j ^ 1;
+            return s < width ? s : j;
+        }
+        
+        digests to_digests(const digest* path, uint32 size) {
+            digests d{};
+            for (uint32 k = size; k > 0; k--) d = d << path[k - 1];
+            return d;
         }
+        
+    }
+    
+    void server::next_path(digest* path, uint32 i) const {
+        for (uint32 level = 0; level + 1 < Height; level++) {
+            uint32 j = i >> level;
+            // everything above here is shared with the previous leaf. 
+            if (i != 0 && j == (i - 1) >> level) return;
+            path[level] = Digests[Offsets[level] + sibling(j, width(level))];
+        }
+    }
+    
+    void server::all_paths(digest* paths) const {
+        if (Height < 2) return;
+        for (uint32 i = 0; i < Width; i++) for (uint32 level = 0; level + 1 < Height; level++) 
+            *paths++ = Digests[Offsets[level] + sibling(i >> level, width(level))];
+    }
+    
+    std::vector<digest> server::all_paths() const {
+        std::vector<digest> paths(Height < 2 ? 0 : size_t(Width) * (Height - 1));
+        all_paths(paths.data());
+        return paths;
     }
     
     proof server::operator[](const digest& d) const {
-        uint32 index = Indices[d];
+        uint32 index = find(d);
         if (index == 0) return {};
         
-        return get_server_proof(Digests, Width, index - 1);
+        std::vector<digest> path(Height - 1);
+        for (uint32 level = 0; level + 1 < Height; level++) 
+            path[level] = Digests[Offsets[level] + sibling((index - 1) >> level, width(level))];
+        
+        return proof{branch{leaf{d, index - 1}, to_digests(path.data(), Height - 1)}, root()};
     }
         
     list<proof> server::proofs() const {
         list<proof> p;
-        for (uint32 i = 0; i < Width; i++) p = p << get_server_proof(Digests, Width, i);
+        digest r = root();
+        all_paths([this, &p, &r](uint32 i, const digest* path) {
+            p = p << proof{branch{leaf{Digests[i], i}, to_digests(path, Height - 1)}, r};
+        });
         return p;
     }
     
+    accumulator& accumulator::append(const digest& d) {
+        digest h = d;
+        uint32 level = 0;
+        
+        // like incrementing a binary counter. 
+        while ((Width >> level) & 1) {
+            // the first time we get to a level, h is next to the first leaf. 
+            if ((Width >> (level + 1)) == 0) Left[level] = h;
+            h = hash_concatinated(Inner[level], h);
+            level++;
+        }
+        
+        Inner[level] = h;
+        Width++;
+        return *this;
+    }
+    
+    // the node at the given level over the last count leaves, where count 
+    // is at most 2^level. Whenever the last node on a level has no neighbor, 
+    // it is paired with itself, as in the rest of the tree. 
+    digest accumulator::fold(uint32 count, uint32 top) const {
+        uint32 level = 0;
+        while (!((count >> level) & 1)) level++;
+        digest h = Inner[level];
+        uint64 c = count;
+        
+        while (c != (uint64(1) << level)) {
+            h = hash_concatinated(h, h);
+            c += uint64(1) << level;
+            level++;
+            while (!((c >> level) & 1)) {
+                h = hash_concatinated(Inner[level], h);
+                level++;
+            }
+        }
+        
+        while (level < top) {
+            h = hash_concatinated(h, h);
+            level++;
+        }
+        
+        return h;
+    }
+    
+    digest accumulator::root() const {
+        if (Width == 0) return {};
+        return fold(Width, 0);
+    }
+    
+    path accumulator::coinbase() const {
+        digests d{};
+        if (Width < 2) return path{0, d};
+        
+        // the highest level with a node next to the first leaf. 
+        uint32 top = 0;
+        while ((uint64(1) << (top + 1)) < Width) top++;
+        
+        // the last one may not be complete. 
+        d = d << (Width >= (uint64(1) << (top + 1)) ? Left[top] : fold(Width - (uint32(1) << top), top));
+        for (uint32 level = top; level > 0; level--) d = d << Left[level - 1];
+        
+        return path{0, d};
+    }
+    
+    coinbase_cache::coinbase_cache(const std::vector<digest>& transactions) : coinbase_cache{} {
+        append(transactions);
+    }
+    
+    coinbase_cache& coinbase_cache::append(const digest& d) {
+        Levels[0].push_back(d);
+        update(Levels[0].size() - 1, Levels[0].size());
+        return *this;
+    }
+    
+    coinbase_cache& coinbase_cache::append(const std::vector<digest>& transactions) {
+        uint32 begin = Levels[0].size();
+        Levels[0].insert(Levels[0].end(), transactions.begin(), transactions.end());
+        update(begin, Levels[0].size());
+        return *this;
+    }
+    
+    bool coinbase_cache::replace(uint32 index, const digest& d) {
+        if (index == 0 || index >= width()) return false;
+        Levels[0][index] = d;
+        update(index, index + 1);
+        return true;
+    }
+    
+    void coinbase_cache::update(uint32 begin, uint32 end) {
+        uint32 level = 0;
+        while (Levels[level].size() > 1) {
+            if (level + 1 == Levels.size()) Levels.emplace_back();
+            
+            const std::vector<digest>& below = Levels[level];
+            Levels[level + 1].resize((below.size() + 1) / 2);
+            
+            // a node that was paired with itself may now have a neighbor, 
+            // which is covered since it is above the first new leaf. 
+            begin = std::max(begin / 2, uint32(1));
+            end = (end + 1) / 2;
+            if (begin < end) hash_level(below.data(), below.size(), Levels[level + 1].data(), begin, end);
+            
+            level++;
+        }
+    }
+    
+    digests coinbase_cache::path() const {
+        digests d{};
+        for (uint32 level = Levels.size() - 1; level > 0; level--) d = d << Levels[level - 1][1];
+        return d;
+    }
+    
+    digest coinbase_cache::root(const digest& coinbase) const {
+        digest d = coinbase;
+        for (uint32 level = 0; level + 1 < Levels.size(); level++) d = hash_concatinated(d, Levels[level][1]);
+        return d;
+    }
+    
 }
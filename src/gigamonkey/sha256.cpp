@@ -0,0 +1,940 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/hash.hpp>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GIGAMONKEY_SHA256_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+// Many messages are hashed at once by distributing them over lanes. Each lane
+// holds the state of one message and is fed one block at a time. When a lane's
+// message is done, the next message is loaded into it. The transformation of
+// a set of lanes can be done with SIMD instructions or with the SHA extensions.
+namespace Gigamonkey::Bitcoin {
+
+    namespace {
+
+        const uint32 Initial[8] = {
+            0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul,
+            0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul};
+
+        alignas(16) const uint32 K[64] = {
+            0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+            0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+            0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+            0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+            0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+            0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+            0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+            0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul};
+
+        inline uint32 read_big(const byte* b) {
+            return (uint32(b[0]) << 24) | (uint32(b[1]) << 16) | (uint32(b[2]) << 8) | uint32(b[3]);
+        }
+
+        inline void write_big(byte* b, uint32 x) {
+            b[0] = byte(x >> 24);
+            b[1] = byte(x >> 16);
+            b[2] = byte(x >> 8);
+            b[3] = byte(x);
+        }
+
+        // all transformations take the states of every lane, stored one
+        // after another, and one block for each lane.
+        using transformation = void (*)(uint32* state, const byte* const* blocks);
+
+        namespace scalar {
+
+            inline uint32 rotate(uint32 x, int n) {
+                return (x >> n) | (x << (32 - n));
+            }
+
+            void transform(uint32* s, const byte* block) {
+                uint32 w[64];
+                for (int i = 0; i < 16; i++) w[i] = read_big(block + 4 * i);
+                for (int i = 16; i < 64; i++) {
+                    uint32 s0 = rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    uint32 s1 = rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+
+                uint32 a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+                for (int i = 0; i < 64; i++) {
+                    uint32 t1 = h + (rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+                    uint32 t2 = (rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                    h = g;
+                    g = f;
+                    f = e;
+                    e = d + t1;
+                    d = c;
+                    c = b;
+                    b = a;
+                    a = t1 + t2;
+                }
+
+                s[0] += a; s[1] += b; s[2] += c; s[3] += d; s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+            }
+
+            void transform_1(uint32* state, const byte* const* blocks) {
+                transform(state, blocks[0]);
+            }
+
+        }
+
+#ifdef GIGAMONKEY_SHA256_X86
+        // SSE2 is part of x86-64 so this is always available there.
+        namespace sse2 {
+
+            using vector = __m128i;
+
+            inline vector add(vector x, vector y) {
+                return _mm_add_epi32(x, y);
+            }
+
+            inline vector add(vector x, vector y, vector z) {
+                return add(add(x, y), z);
+            }
+
+            inline vector add(vector x, vector y, vector z, vector w) {
+                return add(add(x, y), add(z, w));
+            }
+
+            inline vector add(vector x, vector y, vector z, vector w, vector v) {
+                return add(add(x, y, z), add(w, v));
+            }
+
+            inline vector inc(vector& x, vector y) {
+                return x = add(x, y);
+            }
+
+            inline vector rotate(vector x, int n) {
+                return _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n));
+            }
+
+            inline vector big_sigma0(vector x) {
+                return _mm_xor_si128(_mm_xor_si128(rotate(x, 2), rotate(x, 13)), rotate(x, 22));
+            }
+
+            inline vector big_sigma1(vector x) {
+                return _mm_xor_si128(_mm_xor_si128(rotate(x, 6), rotate(x, 11)), rotate(x, 25));
+            }
+
+            inline vector sigma0(vector x) {
+                return _mm_xor_si128(_mm_xor_si128(rotate(x, 7), rotate(x, 18)), _mm_srli_epi32(x, 3));
+            }
+
+            inline vector sigma1(vector x) {
+                return _mm_xor_si128(_mm_xor_si128(rotate(x, 17), rotate(x, 19)), _mm_srli_epi32(x, 10));
+            }
+
+            inline vector choose(vector x, vector y, vector z) {
+                return _mm_xor_si128(z, _mm_and_si128(x, _mm_xor_si128(y, z)));
+            }
+
+            inline vector majority(vector x, vector y, vector z) {
+                return _mm_or_si128(_mm_and_si128(x, y), _mm_and_si128(z, _mm_or_si128(x, y)));
+            }
+
+            inline void round(vector a, vector b, vector c, vector& d, vector e, vector f, vector g, vector& h, vector k) {
+                vector t1 = add(h, big_sigma1(e), choose(e, f, g), k);
+                vector t2 = add(big_sigma0(a), majority(a, b, c));
+                d = add(d, t1);
+                h = add(t1, t2);
+            }
+
+            inline vector load(const byte* const* blocks, int i) {
+                return _mm_set_epi32(
+                    read_big(blocks[3] + 4 * i), read_big(blocks[2] + 4 * i),
+                    read_big(blocks[1] + 4 * i), read_big(blocks[0] + 4 * i));
+            }
+
+            void transform_4(uint32* s, const byte* const* blocks) {
+                vector x[8];
+                for (int i = 0; i < 8; i++) x[i] = _mm_set_epi32(s[24 + i], s[16 + i], s[8 + i], s[i]);
+
+                vector a = x[0], b = x[1], c = x[2], d = x[3], e = x[4], f = x[5], g = x[6], h = x[7];
+
+                vector w[16];
+                for (int i = 0; i < 16; i++) w[i] = load(blocks, i);
+
+                for (int i = 0; i < 64; i += 8) {
+                    if (i >= 16) for (int j = i; j < i + 8; j++)
+                        inc(w[j & 15], add(sigma1(w[(j - 2) & 15]), w[(j - 7) & 15], sigma0(w[(j - 15) & 15])));
+
+                    round(a, b, c, d, e, f, g, h, add(w[(i + 0) & 15], _mm_set1_epi32(K[i + 0])));
+                    round(h, a, b, c, d, e, f, g, add(w[(i + 1) & 15], _mm_set1_epi32(K[i + 1])));
+                    round(g, h, a, b, c, d, e, f, add(w[(i + 2) & 15], _mm_set1_epi32(K[i + 2])));
+                    round(f, g, h, a, b, c, d, e, add(w[(i + 3) & 15], _mm_set1_epi32(K[i + 3])));
+                    round(e, f, g, h, a, b, c, d, add(w[(i + 4) & 15], _mm_set1_epi32(K[i + 4])));
+                    round(d, e, f, g, h, a, b, c, add(w[(i + 5) & 15], _mm_set1_epi32(K[i + 5])));
+                    round(c, d, e, f, g, h, a, b, add(w[(i + 6) & 15], _mm_set1_epi32(K[i + 6])));
+                    round(b, c, d, e, f, g, h, a, add(w[(i + 7) & 15], _mm_set1_epi32(K[i + 7])));
+                }
+
+                alignas(16) uint32 out[8][4];
+                _mm_store_si128((vector*)out[0], add(a, x[0]));
+                _mm_store_si128((vector*)out[1], add(b, x[1]));
+                _mm_store_si128((vector*)out[2], add(c, x[2]));
+                _mm_store_si128((vector*)out[3], add(d, x[3]));
+                _mm_store_si128((vector*)out[4], add(e, x[4]));
+                _mm_store_si128((vector*)out[5], add(f, x[5]));
+                _mm_store_si128((vector*)out[6], add(g, x[6]));
+                _mm_store_si128((vector*)out[7], add(h, x[7]));
+
+                for (int lane = 0; lane < 4; lane++) for (int i = 0; i < 8; i++) s[8 * lane + i] = out[i][lane];
+            }
+
+        }
+
+        namespace avx2 {
+
+            using vector = __m256i;
+
+#define GIGAMONKEY_AVX2 __attribute__((target("avx2")))
+
+            GIGAMONKEY_AVX2 inline vector add(vector x, vector y) {
+                return _mm256_add_epi32(x, y);
+            }
+
+            GIGAMONKEY_AVX2 inline vector add(vector x, vector y, vector z) {
+                return add(add(x, y), z);
+            }
+
+            GIGAMONKEY_AVX2 inline vector add(vector x, vector y, vector z, vector w) {
+                return add(add(x, y), add(z, w));
+            }
+
+            GIGAMONKEY_AVX2 inline vector inc(vector& x, vector y) {
+                return x = add(x, y);
+            }
+
+            GIGAMONKEY_AVX2 inline vector rotate(vector x, int n) {
+                return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+            }
+
+            GIGAMONKEY_AVX2 inline vector big_sigma0(vector x) {
+                return _mm256_xor_si256(_mm256_xor_si256(rotate(x, 2), rotate(x, 13)), rotate(x, 22));
+            }
+
+            GIGAMONKEY_AVX2 inline vector big_sigma1(vector x) {
+                return _mm256_xor_si256(_mm256_xor_si256(rotate(x, 6), rotate(x, 11)), rotate(x, 25));
+            }
+
+            GIGAMONKEY_AVX2 inline vector sigma0(vector x) {
+                return _mm256_xor_si256(_mm256_xor_si256(rotate(x, 7), rotate(x, 18)), _mm256_srli_epi32(x, 3));
+            }
+
+            GIGAMONKEY_AVX2 inline vector sigma1(vector x) {
+                return _mm256_xor_si256(_mm256_xor_si256(rotate(x, 17), rotate(x, 19)), _mm256_srli_epi32(x, 10));
+            }
+
+            GIGAMONKEY_AVX2 inline vector choose(vector x, vector y, vector z) {
+                return _mm256_xor_si256(z, _mm256_and_si256(x, _mm256_xor_si256(y, z)));
+            }
+
+            GIGAMONKEY_AVX2 inline vector majority(vector x, vector y, vector z) {
+                return _mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y)));
+            }
+
+            GIGAMONKEY_AVX2 inline void round(vector a, vector b, vector c, vector& d, vector e, vector f, vector g, vector& h, vector k) {
+                vector t1 = add(h, big_sigma1(e), choose(e, f, g), k);
+                vector t2 = add(big_sigma0(a), majority(a, b, c));
+                d = add(d, t1);
+                h = add(t1, t2);
+            }
+
+            GIGAMONKEY_AVX2 inline vector load(const byte* const* blocks, int i) {
+                return _mm256_set_epi32(
+                    read_big(blocks[7] + 4 * i), read_big(blocks[6] + 4 * i),
+                    read_big(blocks[5] + 4 * i), read_big(blocks[4] + 4 * i),
+                    read_big(blocks[3] + 4 * i), read_big(blocks[2] + 4 * i),
+                    read_big(blocks[1] + 4 * i), read_big(blocks[0] + 4 * i));
+            }
+
+            GIGAMONKEY_AVX2 void transform_8(uint32* s, const byte* const* blocks) {
+                vector x[8];
+                for (int i = 0; i < 8; i++) x[i] = _mm256_set_epi32(
+                    s[56 + i], s[48 + i], s[40 + i], s[32 + i], s[24 + i], s[16 + i], s[8 + i], s[i]);
+
+                vector a = x[0], b = x[1], c = x[2], d = x[3], e = x[4], f = x[5], g = x[6], h = x[7];
+
+                vector w[16];
+                for (int i = 0; i < 16; i++) w[i] = load(blocks, i);
+
+                for (int i = 0; i < 64; i += 8) {
+                    if (i >= 16) for (int j = i; j < i + 8; j++)
+                        inc(w[j & 15], add(sigma1(w[(j - 2) & 15]), w[(j - 7) & 15], sigma0(w[(j - 15) & 15])));
+
+                    round(a, b, c, d, e, f, g, h, add(w[(i + 0) & 15], _mm256_set1_epi32(K[i + 0])));
+                    round(h, a, b, c, d, e, f, g, add(w[(i + 1) & 15], _mm256_set1_epi32(K[i + 1])));
+                    round(g, h, a, b, c, d, e, f, add(w[(i + 2) & 15], _mm256_set1_epi32(K[i + 2])));
+                    round(f, g, h, a, b, c, d, e, add(w[(i + 3) & 15], _mm256_set1_epi32(K[i + 3])));
+                    round(e, f, g, h, a, b, c, d, add(w[(i + 4) & 15], _mm256_set1_epi32(K[i + 4])));
+                    round(d, e, f, g, h, a, b, c, add(w[(i + 5) & 15], _mm256_set1_epi32(K[i + 5])));
+                    round(c, d, e, f, g, h, a, b, add(w[(i + 6) & 15], _mm256_set1_epi32(K[i + 6])));
+                    round(b, c, d, e, f, g, h, a, add(w[(i + 7) & 15], _mm256_set1_epi32(K[i + 7])));
+                }
+
+                alignas(32) uint32 out[8][8];
+                _mm256_store_si256((vector*)out[0], add(a, x[0]));
+                _mm256_store_si256((vector*)out[1], add(b, x[1]));
+                _mm256_store_si256((vector*)out[2], add(c, x[2]));
+                _mm256_store_si256((vector*)out[3], add(d, x[3]));
+                _mm256_store_si256((vector*)out[4], add(e, x[4]));
+                _mm256_store_si256((vector*)out[5], add(f, x[5]));
+                _mm256_store_si256((vector*)out[6], add(g, x[6]));
+                _mm256_store_si256((vector*)out[7], add(h, x[7]));
+
+                for (int lane = 0; lane < 8; lane++) for (int i = 0; i < 8; i++) s[8 * lane + i] = out[i][lane];
+            }
+
+            // the words of the second half of an 80 byte header, where the nonce 
+            // is different in every lane, and of the second round of hashing. 
+            GIGAMONKEY_AVX2 inline void compress(vector* x, vector* w) {
+                vector a = x[0], b = x[1], c = x[2], d = x[3], e = x[4], f = x[5], g = x[6], h = x[7];
+
+                for (int i = 0; i < 64; i += 8) {
+                    if (i >= 16) for (int j = i; j < i + 8; j++)
+                        inc(w[j & 15], add(sigma1(w[(j - 2) & 15]), w[(j - 7) & 15], sigma0(w[(j - 15) & 15])));
+
+                    round(a, b, c, d, e, f, g, h, add(w[(i + 0) & 15], _mm256_set1_epi32(K[i + 0])));
+                    round(h, a, b, c, d, e, f, g, add(w[(i + 1) & 15], _mm256_set1_epi32(K[i + 1])));
+                    round(g, h, a, b, c, d, e, f, add(w[(i + 2) & 15], _mm256_set1_epi32(K[i + 2])));
+                    round(f, g, h, a, b, c, d, e, add(w[(i + 3) & 15], _mm256_set1_epi32(K[i + 3])));
+                    round(e, f, g, h, a, b, c, d, add(w[(i + 4) & 15], _mm256_set1_epi32(K[i + 4])));
+                    round(d, e, f, g, h, a, b, c, add(w[(i + 5) & 15], _mm256_set1_epi32(K[i + 5])));
+                    round(c, d, e, f, g, h, a, b, add(w[(i + 6) & 15], _mm256_set1_epi32(K[i + 6])));
+                    round(b, c, d, e, f, g, h, a, add(w[(i + 7) & 15], _mm256_set1_epi32(K[i + 7])));
+                }
+
+                inc(x[0], a); inc(x[1], b); inc(x[2], c); inc(x[3], d);
+                inc(x[4], e); inc(x[5], f); inc(x[6], g); inc(x[7], h);
+            }
+
+            GIGAMONKEY_AVX2 inline vector byte_swap(vector x) {
+                return _mm256_shuffle_epi8(x, _mm256_set_epi8(
+                    12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                    12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3));
+            }
+
+            // hash 8 nonces at a time. The nonces in a batch whose digests have a top word 
+            // no greater than top are candidates, and the scan stops after such a batch. 
+            GIGAMONKEY_AVX2 uint32 scan_8(const uint32* midstate, const byte* tail,
+                uint32 begin, uint32 count, uint32 top, uint32* candidates, uint32& found) {
+                const vector lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+                const vector max = _mm256_set1_epi32(top);
+
+                found = 0;
+                uint32 scanned = 0;
+                while (scanned < count) {
+                    vector w[16];
+                    w[0] = _mm256_set1_epi32(read_big(tail));
+                    w[1] = _mm256_set1_epi32(read_big(tail + 4));
+                    w[2] = _mm256_set1_epi32(read_big(tail + 8));
+                    w[3] = byte_swap(add(_mm256_set1_epi32(begin + scanned), lanes));
+                    w[4] = _mm256_set1_epi32(0x80000000);
+                    for (int i = 5; i < 15; i++) w[i] = _mm256_setzero_si256();
+                    w[15] = _mm256_set1_epi32(80 * 8);
+
+                    vector x[8];
+                    for (int i = 0; i < 8; i++) x[i] = _mm256_set1_epi32(midstate[i]);
+                    compress(x, w);
+
+                    for (int i = 0; i < 8; i++) w[i] = x[i];
+                    w[8] = _mm256_set1_epi32(0x80000000);
+                    for (int i = 9; i < 15; i++) w[i] = _mm256_setzero_si256();
+                    w[15] = _mm256_set1_epi32(32 * 8);
+
+                    for (int i = 0; i < 8; i++) x[i] = _mm256_set1_epi32(Initial[i]);
+                    compress(x, w);
+
+                    // the top word of the digest read as a little endian number. 
+                    vector t = byte_swap(x[7]);
+                    uint32 mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_min_epu32(t, max), t)));
+
+                    uint32 n = count - scanned < 8 ? count - scanned : 8;
+                    mask &= (1u << n) - 1;
+                    for (uint32 l = 0; l < n; l++) if ((mask >> l) & 1) candidates[found++] = begin + scanned + l;
+                    scanned += n;
+                    if (found > 0) break;
+                }
+
+                return scanned;
+            }
+
+#undef GIGAMONKEY_AVX2
+
+        }
+
+        // only used to scan nonces, since it needs every lane to have the same midstate.
+        namespace avx512 {
+
+            using vector = __m512i;
+
+#define GIGAMONKEY_AVX512 __attribute__((target("avx512f,avx512bw")))
+
+            GIGAMONKEY_AVX512 inline vector add(vector x, vector y) {
+                return _mm512_add_epi32(x, y);
+            }
+
+            GIGAMONKEY_AVX512 inline vector add(vector x, vector y, vector z) {
+                return add(add(x, y), z);
+            }
+
+            GIGAMONKEY_AVX512 inline vector add(vector x, vector y, vector z, vector w) {
+                return add(add(x, y), add(z, w));
+            }
+
+            GIGAMONKEY_AVX512 inline vector inc(vector& x, vector y) {
+                return x = add(x, y);
+            }
+
+            template <int n> GIGAMONKEY_AVX512 inline vector rotate(vector x) {
+                return _mm512_ror_epi32(x, n);
+            }
+
+            GIGAMONKEY_AVX512 inline vector big_sigma0(vector x) {
+                return _mm512_xor_si512(_mm512_xor_si512(rotate<2>(x), rotate<13>(x)), rotate<22>(x));
+            }
+
+            GIGAMONKEY_AVX512 inline vector big_sigma1(vector x) {
+                return _mm512_xor_si512(_mm512_xor_si512(rotate<6>(x), rotate<11>(x)), rotate<25>(x));
+            }
+
+            GIGAMONKEY_AVX512 inline vector sigma0(vector x) {
+                return _mm512_xor_si512(_mm512_xor_si512(rotate<7>(x), rotate<18>(x)), _mm512_srli_epi32(x, 3));
+            }
+
+            GIGAMONKEY_AVX512 inline vector sigma1(vector x) {
+                return _mm512_xor_si512(_mm512_xor_si512(rotate<17>(x), rotate<19>(x)), _mm512_srli_epi32(x, 10));
+            }
+
+            // bitwise select and majority in one instruction each.
+            GIGAMONKEY_AVX512 inline vector choose(vector x, vector y, vector z) {
+                return _mm512_ternarylogic_epi32(x, y, z, 0xca);
+            }
+
+            GIGAMONKEY_AVX512 inline vector majority(vector x, vector y, vector z) {
+                return _mm512_ternarylogic_epi32(x, y, z, 0xe8);
+            }
+
+            GIGAMONKEY_AVX512 inline void round(vector a, vector b, vector c, vector& d, vector e, vector f, vector g, vector& h, vector k) {
+                vector t1 = add(h, big_sigma1(e), choose(e, f, g), k);
+                vector t2 = add(big_sigma0(a), majority(a, b, c));
+                d = add(d, t1);
+                h = add(t1, t2);
+            }
+
+            GIGAMONKEY_AVX512 inline void compress(vector* x, vector* w) {
+                vector a = x[0], b = x[1], c = x[2], d = x[3], e = x[4], f = x[5], g = x[6], h = x[7];
+
+                for (int i = 0; i < 64; i += 8) {
+                    if (i >= 16) for (int j = i; j < i + 8; j++)
+                        inc(w[j & 15], add(sigma1(w[(j - 2) & 15]), w[(j - 7) & 15], sigma0(w[(j - 15) & 15])));
+
+                    round(a, b, c, d, e, f, g, h, add(w[(i + 0) & 15], _mm512_set1_epi32(K[i + 0])));
+                    round(h, a, b, c, d, e, f, g, add(w[(i + 1) & 15], _mm512_set1_epi32(K[i + 1])));
+                    round(g, h, a, b, c, d, e, f, add(w[(i + 2) & 15], _mm512_set1_epi32(K[i + 2])));
+                    round(f, g, h, a, b, c, d, e, add(w[(i + 3) & 15], _mm512_set1_epi32(K[i + 3])));
+                    round(e, f, g, h, a, b, c, d, add(w[(i + 4) & 15], _mm512_set1_epi32(K[i + 4])));
+                    round(d, e, f, g, h, a, b, c, add(w[(i + 5) & 15], _mm512_set1_epi32(K[i + 5])));
+                    round(c, d, e, f, g, h, a, b, add(w[(i + 6) & 15], _mm512_set1_epi32(K[i + 6])));
+                    round(b, c, d, e, f, g, h, a, add(w[(i + 7) & 15], _mm512_set1_epi32(K[i + 7])));
+                }
+
+                inc(x[0], a); inc(x[1], b); inc(x[2], c); inc(x[3], d);
+                inc(x[4], e); inc(x[5], f); inc(x[6], g); inc(x[7], h);
+            }
+
+            GIGAMONKEY_AVX512 inline vector byte_swap(vector x) {
+                return _mm512_shuffle_epi8(x, _mm512_broadcast_i32x4(
+                    _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3)));
+            }
+
+            // the same as avx2::scan_8 with 16 nonces at a time.
+            GIGAMONKEY_AVX512 uint32 scan_16(const uint32* midstate, const byte* tail,
+                uint32 begin, uint32 count, uint32 top, uint32* candidates, uint32& found) {
+                const vector lanes = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+                const vector max = _mm512_set1_epi32(top);
+
+                found = 0;
+                uint32 scanned = 0;
+                while (scanned < count) {
+                    vector w[16];
+                    w[0] = _mm512_set1_epi32(read_big(tail));
+                    w[1] = _mm512_set1_epi32(read_big(tail + 4));
+                    w[2] = _mm512_set1_epi32(read_big(tail + 8));
+                    w[3] = byte_swap(add(_mm512_set1_epi32(begin + scanned), lanes));
+                    w[4] = _mm512_set1_epi32(0x80000000);
+                    for (int i = 5; i < 15; i++) w[i] = _mm512_setzero_si512();
+                    w[15] = _mm512_set1_epi32(80 * 8);
+
+                    vector x[8];
+                    for (int i = 0; i < 8; i++) x[i] = _mm512_set1_epi32(midstate[i]);
+                    compress(x, w);
+
+                    for (int i = 0; i < 8; i++) w[i] = x[i];
+                    w[8] = _mm512_set1_epi32(0x80000000);
+                    for (int i = 9; i < 15; i++) w[i] = _mm512_setzero_si512();
+                    w[15] = _mm512_set1_epi32(32 * 8);
+
+                    for (int i = 0; i < 8; i++) x[i] = _mm512_set1_epi32(Initial[i]);
+                    compress(x, w);
+
+                    uint32 mask = _mm512_cmple_epu32_mask(byte_swap(x[7]), max);
+
+                    uint32 n = count - scanned < 16 ? count - scanned : 16;
+                    mask &= (1u << n) - 1;
+                    for (uint32 l = 0; l < n; l++) if ((mask >> l) & 1) candidates[found++] = begin + scanned + l;
+                    scanned += n;
+                    if (found > 0) break;
+                }
+
+                return scanned;
+            }
+
+#undef GIGAMONKEY_AVX512
+
+        }
+
+        // the SHA extensions work on one message at a time, but much faster.
+        namespace shani {
+
+#define GIGAMONKEY_SHANI __attribute__((target("sha,sse4.1")))
+
+            GIGAMONKEY_SHANI inline void quad_round(__m128i& state0, __m128i& state1, __m128i m, int i) {
+                __m128i msg = _mm_add_epi32(m, _mm_load_si128((const __m128i*)(K + i)));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+            }
+
+            GIGAMONKEY_SHANI inline void schedule(__m128i& m0, __m128i m1, __m128i m2, __m128i m3) {
+                m0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m0, m1), _mm_alignr_epi8(m3, m2, 4)), m3);
+            }
+
+            GIGAMONKEY_SHANI void transform(uint32* s, const byte* block) {
+                const __m128i swap = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+
+                // the SHA instructions want the state as (a, b, e, f) and (c, d, g, h).
+                __m128i t = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s), 0xb1);
+                __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(s + 4)), 0x1b);
+                __m128i state0 = _mm_alignr_epi8(t, state1, 8);
+                state1 = _mm_blend_epi16(state1, t, 0xf0);
+
+                __m128i save0 = state0;
+                __m128i save1 = state1;
+
+                __m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block)), swap);
+                __m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 16)), swap);
+                __m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 32)), swap);
+                __m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 48)), swap);
+
+                quad_round(state0, state1, m0, 0);
+                quad_round(state0, state1, m1, 4);
+                quad_round(state0, state1, m2, 8);
+                quad_round(state0, state1, m3, 12);
+
+                for (int i = 16; i < 64; i += 16) {
+                    schedule(m0, m1, m2, m3);
+                    quad_round(state0, state1, m0, i);
+                    schedule(m1, m2, m3, m0);
+                    quad_round(state0, state1, m1, i + 4);
+                    schedule(m2, m3, m0, m1);
+                    quad_round(state0, state1, m2, i + 8);
+                    schedule(m3, m0, m1, m2);
+                    quad_round(state0, state1, m3, i + 12);
+                }
+
+                state0 = _mm_add_epi32(state0, save0);
+                state1 = _mm_add_epi32(state1, save1);
+
+                t = _mm_shuffle_epi32(state0, 0x1b);
+                state1 = _mm_shuffle_epi32(state1, 0xb1);
+                _mm_storeu_si128((__m128i*)s, _mm_blend_epi16(t, state1, 0xf0));
+                _mm_storeu_si128((__m128i*)(s + 4), _mm_alignr_epi8(state1, t, 8));
+            }
+
+            GIGAMONKEY_SHANI void transform_1(uint32* state, const byte* const* blocks) {
+                transform(state, blocks[0]);
+            }
+
+#undef GIGAMONKEY_SHANI
+
+        }
+
+        struct cpu {
+            bool AVX2;
+            bool AVX512;
+            bool SHA;
+
+            cpu() : AVX2{false}, AVX512{false}, SHA{false} {
+                uint32 a, b, c, d;
+                if (__get_cpuid_max(0, nullptr) < 7) return;
+                __cpuid_count(1, 0, a, b, c, d);
+                bool sse41 = (c >> 19) & 1;
+                bool osxsave = (c >> 27) & 1;
+                bool avx = (c >> 28) & 1;
+                __cpuid_count(7, 0, a, b, c, d);
+                SHA = sse41 && ((b >> 29) & 1);
+
+                // AVX2 also requires that the OS saves the ymm registers.
+                if (!(osxsave && avx)) return;
+                uint32 xcr0_low, xcr0_high;
+                __asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+                AVX2 = ((xcr0_low & 6) == 6) && ((b >> 5) & 1);
+
+                // AVX-512 foundation and byte instructions, with the zmm and mask registers saved.
+                AVX512 = ((xcr0_low & 0xe6) == 0xe6) && ((b >> 16) & 1) && ((b >> 30) & 1);
+            }
+        };
+#endif
+
+        // a lane holds a message that is being hashed. The padded end of the
+        // message, which is one or two blocks, is copied into Tail.
+        struct lane {
+            const byte* Data;
+            digest256* Digest;
+
+            // number of blocks that are read directly from Data.
+            size_t Direct;
+            size_t Blocks;
+            size_t Block;
+
+            // whether we are on the second round of hashing.
+            bool Second;
+
+            byte Tail[128];
+
+            const byte* block() const {
+                return Block < Direct ? Data + 64 * Block : Tail + 64 * (Block - Direct);
+            }
+
+            void load(const bytes_view m, digest256* d) {
+                Data = m.data();
+                Digest = d;
+                Direct = m.size() / 64;
+                size_t remainder = m.size() % 64;
+                size_t tail = remainder + 9 <= 64 ? 1 : 2;
+                Blocks = Direct + tail;
+                Block = 0;
+                Second = false;
+
+                std::memset(Tail, 0, 64 * tail);
+                if (remainder > 0) std::memcpy(Tail, Data + 64 * Direct, remainder);
+                Tail[remainder] = 0x80;
+                uint64 bits = uint64(m.size()) << 3;
+                byte* end = Tail + 64 * tail;
+                write_big(end - 8, uint32(bits >> 32));
+                write_big(end - 4, uint32(bits));
+            }
+
+            // the second hash is always of a 32 byte message, so it is one block.
+            void finish_first(uint32* state) {
+                std::memset(Tail, 0, 64);
+                for (int i = 0; i < 8; i++) {
+                    write_big(Tail + 4 * i, state[i]);
+                    state[i] = Initial[i];
+                }
+                Tail[32] = 0x80;
+                Tail[62] = 0x01;
+                Direct = 0;
+                Blocks = 1;
+                Block = 0;
+                Second = true;
+            }
+
+            void finish_second(const uint32* state) {
+                byte* d = Digest->Value.data();
+                for (int i = 0; i < 8; i++) write_big(d + 4 * i, state[i]);
+            }
+        };
+
+        template <size_t lanes>
+        void hash256_lanes(transformation transform, const bytes_view* messages, digest256* digests, size_t count) {
+            static const byte Empty[64]{};
+
+            uint32 state[8 * lanes];
+            lane Lanes[lanes];
+            bool active[lanes];
+            const byte* blocks[lanes];
+
+            size_t next = 0;
+            size_t running = 0;
+
+            auto load = [&](size_t l) {
+                if (next == count) {
+                    active[l] = false;
+                    return;
+                }
+
+                Lanes[l].load(messages[next], digests + next);
+                std::copy(Initial, Initial + 8, state + 8 * l);
+                active[l] = true;
+                running++;
+                next++;
+            };
+
+            for (size_t l = 0; l < lanes; l++) load(l);
+
+            while (running > 0) {
+                for (size_t l = 0; l < lanes; l++) blocks[l] = active[l] ? Lanes[l].block() : Empty;
+
+                transform(state, blocks);
+
+                for (size_t l = 0; l < lanes; l++) {
+                    if (!active[l]) continue;
+                    lane& x = Lanes[l];
+                    if (++x.Block < x.Blocks) continue;
+                    if (!x.Second) {
+                        x.finish_first(state + 8 * l);
+                        continue;
+                    }
+
+                    x.finish_second(state + 8 * l);
+                    running--;
+                    load(l);
+                }
+            }
+        }
+
+        struct engine {
+            string Name;
+            void (*Hash)(transformation, const bytes_view*, digest256*, size_t);
+            transformation Transform;
+
+            // for hashing one block at a time.
+            void (*Single)(uint32* state, const byte* block);
+
+            engine(const string& name, void (*hash)(transformation, const bytes_view*, digest256*, size_t),
+                transformation t, void (*single)(uint32*, const byte*)) :
+                Name{name}, Hash{hash}, Transform{t}, Single{single} {}
+
+            // every engine that runs on this cpu, best first.
+            static const std::vector<engine>& available() {
+                static const std::vector<engine> Engines = [] {
+                    std::vector<engine> x;
+#ifdef GIGAMONKEY_SHA256_X86
+                    cpu c{};
+                    if (c.SHA) x.emplace_back("sha-ni", hash256_lanes<1>, shani::transform_1, shani::transform);
+                    if (c.AVX2) x.emplace_back("avx2 8-way", hash256_lanes<8>, avx2::transform_8, scalar::transform);
+                    x.emplace_back("sse2 4-way", hash256_lanes<4>, sse2::transform_4, scalar::transform);
+#endif
+                    x.emplace_back("scalar", hash256_lanes<1>, scalar::transform_1, scalar::transform);
+                    return x;
+                }();
+                return Engines;
+            }
+
+            static const engine& get() {
+                return available().front();
+            }
+        };
+
+        using scanner = uint32 (*)(const uint32* midstate, const byte* tail,
+            uint32 begin, uint32 count, uint32 top, uint32* candidates, uint32& found);
+
+        uint32 scan_1(const uint32* midstate, const byte* tail,
+            uint32 begin, uint32 count, uint32 top, uint32* candidates, uint32& found) {
+            byte t[16];
+            std::memcpy(t, tail, 12);
+
+            found = 0;
+            uint32 scanned = 0;
+            while (scanned < count) {
+                uint32 nonce = begin + scanned++;
+                t[12] = byte(nonce);
+                t[13] = byte(nonce >> 8);
+                t[14] = byte(nonce >> 16);
+                t[15] = byte(nonce >> 24);
+
+                digest256 digest = hash256_80(midstate, t);
+                const byte* d = digest.Value.data();
+                uint32 word = uint32(d[28]) | (uint32(d[29]) << 8) | (uint32(d[30]) << 16) | (uint32(d[31]) << 24);
+                if (word <= top) {
+                    candidates[found++] = nonce;
+                    break;
+                }
+            }
+
+            return scanned;
+        }
+
+        struct scan_engine {
+            string Name;
+            scanner Scan;
+
+            scan_engine(const string& name, scanner scan) : Name{name}, Scan{scan} {}
+
+            // every engine that runs on this cpu, best first.
+            static const std::vector<scan_engine>& available() {
+                static const std::vector<scan_engine> Engines = [] {
+                    std::vector<scan_engine> x;
+#ifdef GIGAMONKEY_SHA256_X86
+                    cpu c{};
+                    if (c.AVX512) x.emplace_back("avx-512 16-way", avx512::scan_16);
+                    if (c.AVX2) x.emplace_back("avx2 8-way", avx2::scan_8);
+#endif
+                    x.emplace_back("one at a time", scan_1);
+                    return x;
+                }();
+                return Engines;
+            }
+
+            static const scan_engine& get() {
+                return available().front();
+            }
+        };
+
+        // finish a hash256 given the state after the first hash. 
+        digest256 second(void (*single)(uint32*, const byte*), const uint32* first) {
+            byte block[64]{};
+            for (int i = 0; i < 8; i++) write_big(block + 4 * i, first[i]);
+            block[32] = 0x80;
+            write_big(block + 60, 32 * 8);
+
+            uint32 state[8];
+            std::copy(Initial, Initial + 8, state);
+            single(state, block);
+
+            digest256 d;
+            for (int i = 0; i < 8; i++) write_big(d.Value.data() + 4 * i, state[i]);
+            return d;
+        }
+
+    }
+
+    void hash256_many(const bytes_view* messages, digest256* digests, size_t count) {
+        const engine& e = engine::get();
+        e.Hash(e.Transform, messages, digests, count);
+    }
+
+    std::vector<digest256> hash256_many(const std::vector<bytes_view>& messages) {
+        std::vector<digest256> digests(messages.size());
+        hash256_many(messages.data(), digests.data(), messages.size());
+        return digests;
+    }
+
+    const string& hash256_engine() {
+        return engine::get().Name;
+    }
+
+    std::vector<string> hash256_engines() {
+        std::vector<string> x;
+        for (const engine& e : engine::available()) x.push_back(e.Name);
+        return x;
+    }
+
+    bool hash256_many(const string& name, const bytes_view* messages, digest256* digests, size_t count) {
+        for (const engine& e : engine::available()) if (e.Name == name) {
+            e.Hash(e.Transform, messages, digests, count);
+            return true;
+        }
+
+        return false;
+    }
+
+    void sha256_midstate(const byte* first_block, uint32* state) {
+        std::copy(Initial, Initial + 8, state);
+        engine::get().Single(state, first_block);
+    }
+
+    digest256 hash256_80(const uint32* midstate, const byte* tail) {
+        auto single = engine::get().Single;
+
+        // the rest of the message and its padding.
+        byte block[64]{};
+        std::memcpy(block, tail, 16);
+        block[16] = 0x80;
+        write_big(block + 60, 80 * 8);
+
+        uint32 state[8];
+        std::copy(midstate, midstate + 8, state);
+        single(state, block);
+
+        return second(single, state);
+    }
+
+    uint32 hash256_80_scan(const uint32* midstate, const byte* tail,
+        uint32 begin, uint32 count, uint32 top, uint32* candidates, uint32& found) {
+        return scan_engine::get().Scan(midstate, tail, begin, count, top, candidates, found);
+    }
+
+    const string& hash256_80_scan_engine() {
+        return scan_engine::get().Name;
+    }
+
+    std::vector<string> hash256_80_scan_engines() {
+        std::vector<string> x;
+        for (const scan_engine& e : scan_engine::available()) x.push_back(e.Name);
+        return x;
+    }
+
+    uint32 hash256_80_scan(const string& name, const uint32* midstate, const byte* tail,
+        uint32 begin, uint32 count, uint32 top, uint32* candidates, uint32& found) {
+        found = 0;
+        for (const scan_engine& e : scan_engine::available())
+            if (e.Name == name) return e.Scan(midstate, tail, begin, count, top, candidates, found);
+        return 0;
+    }
+
+    hash256_prefix::hash256_prefix() : State{}, Rest{}, Length{0} {
+        std::copy(Initial, Initial + 8, State.begin());
+    }
+
+    hash256_prefix::hash256_prefix(bytes_view prefix) : hash256_prefix{} {
+        auto single = engine::get().Single;
+        size_t blocks = prefix.size() / 64;
+        for (size_t i = 0; i < blocks; i++) single(State.data(), prefix.data() + 64 * i);
+        std::memcpy(Rest.data(), prefix.data() + 64 * blocks, prefix.size() % 64);
+        Length = prefix.size();
+    }
+
+    digest256 hash256_prefix::operator()(const bytes_view* parts, size_t count) const {
+        auto single = engine::get().Single;
+
+        uint32 state[8];
+        std::copy(State.begin(), State.end(), state);
+
+        byte block[64];
+        size_t filled = Length % 64;
+        std::memcpy(block, Rest.data(), filled);
+
+        uint64 length = Length;
+        for (size_t i = 0; i < count; i++) {
+            const byte* b = parts[i].data();
+            size_t remaining = parts[i].size();
+            length += remaining;
+            while (remaining > 0) {
+                size_t n = std::min(remaining, 64 - filled);
+                std::memcpy(block + filled, b, n);
+                filled += n;
+                b += n;
+                remaining -= n;
+                if (filled == 64) {
+                    single(state, block);
+                    filled = 0;
+                }
+            }
+        }
+
+        // padding.
+        block[filled++] = 0x80;
+        if (filled > 56) {
+            std::memset(block + filled, 0, 64 - filled);
+            single(state, block);
+            filled = 0;
+        }
+
+        std::memset(block + filled, 0, 56 - filled);
+        write_big(block + 56, uint32((length * 8) >> 32));
+        write_big(block + 60, uint32(length * 8));
+        single(state, block);
+
+        return second(single, state);
+    }
+
+}
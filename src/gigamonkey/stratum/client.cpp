@@ -0,0 +1,303 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/client.hpp>
+#include <gigamonkey/stratum/codec.hpp>
+#include <boost/asio.hpp>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace Gigamonkey::Stratum {
+
+    namespace asio = boost::asio;
+    using tcp = asio::ip::tcp;
+
+    using handler = std::function<void(const response&)>;
+
+    struct client::connection {
+        client& Client;
+        asio::io_context IO;
+        tcp::socket Socket;
+        asio::streambuf Input;
+        std::thread Thread;
+
+        // requests may not be posted once the connection has been stopped.
+        std::mutex Mutex;
+        bool Stopped;
+
+        std::atomic<bool> Open;
+
+        // the following are only touched from the connection's thread.
+        bool Closed;
+        std::map<request_id, handler> Requests;
+        std::deque<std::shared_ptr<const string>> Output;
+
+        // reused for every job that the server sends.
+        mining::notify::parameters Job;
+
+        connection(client& c) : Client{c}, IO{1}, Socket{IO}, Input{c.Options.MaxMessageSize}, Thread{},
+            Mutex{}, Stopped{false}, Open{false}, Closed{false}, Requests{}, Output{}, Job{} {}
+
+        void read();
+        void receive(const string& message);
+        void send(request_id, std::shared_ptr<const string>, handler);
+        void write();
+        void close();
+    };
+
+    void client::connection::read() {
+        asio::async_read_until(Socket, Input, '\n', [this](const boost::system::error_code& err, size_t n) {
+            if (err || Closed) return close();
+
+            auto data = Input.data();
+            string message(asio::buffers_begin(data), asio::buffers_begin(data) + n - 1);
+            Input.consume(n);
+
+            try {
+                receive(message);
+            } catch (...) {
+                close();
+            }
+
+            if (!Closed) read();
+        });
+    }
+
+    void client::connection::receive(const string& message) {
+        if (message.empty() || message == "\r") return;
+
+        // jobs are read without the json types.
+        if (codec::decode(message, Job)) {
+            if (Job.valid() && Client.Notify) Client.Notify(Job);
+            return;
+        }
+
+        json j = json::parse(message, nullptr, false);
+        if (j.is_discarded()) return close();
+
+        if (response::valid(j)) {
+            auto r = Requests.find(response::id(j));
+            if (r == Requests.end()) return;
+            handler h = std::move(r->second);
+            Requests.erase(r);
+            Client.Pending--;
+            return h(response{j});
+        }
+
+        if (!notification::valid(j)) return;
+
+        switch (notification::method(j)) {
+            case mining_set_difficulty: {
+                difficulty d = mining::set_difficulty::deserialize(notification::params(j));
+                if (!d.valid()) return;
+                Client.Difficulty = d.Value;
+                if (Client.SetDifficulty) Client.SetDifficulty(d);
+                return;
+            }
+
+            case mining_notify: {
+                auto p = mining::notify::deserialize(notification::params(j));
+                if (!p.valid()) return;
+                if (Client.Notify) Client.Notify(p);
+                return;
+            }
+
+            default: return;
+        }
+    }
+
+    void client::connection::send(request_id id, std::shared_ptr<const string> x, handler h) {
+        if (Closed) {
+            Client.Pending--;
+            return h(response{});
+        }
+
+        Requests[id] = std::move(h);
+        Output.push_back(std::move(x));
+        if (Output.size() == 1) write();
+    }
+
+    void client::connection::write() {
+        asio::async_write(Socket, asio::buffer(*Output.front()), [this](const boost::system::error_code& err, size_t) {
+            if (err || Closed) return close();
+            Output.pop_front();
+            if (!Output.empty()) write();
+        });
+    }
+
+    // every request that has not been answered gets an empty response.
+    void client::connection::close() {
+        if (Closed) return;
+        Closed = true;
+        Open = false;
+        boost::system::error_code err;
+        Socket.shutdown(tcp::socket::shutdown_both, err);
+        Socket.close(err);
+        Output.clear();
+
+        auto requests = std::move(Requests);
+        Requests.clear();
+        for (auto& r : requests) {
+            Client.Pending--;
+            r.second(response{});
+        }
+    }
+
+    client::client(const options& o) : Notify{}, SetDifficulty{}, Options{o}, Connection{},
+        NextID{1}, Pending{0}, Difficulty{0}, ExtraNonce1{}, ExtraNonce2Size{0} {}
+
+    client::~client() {
+        stop();
+    }
+
+    bool client::start() {
+        // a connection that has closed is replaced by a new one. If the
+        // server hung up, the connection's thread is still running.
+        if (Connection != nullptr) {
+            if (Connection->Open) return false;
+            stop();
+            Connection = nullptr;
+        }
+
+        Connection = std::make_unique<connection>(*this);
+        connection* c = Connection.get();
+
+        boost::system::error_code err;
+        tcp::resolver resolver{c->IO};
+        auto endpoints = resolver.resolve(Options.Address, std::to_string(Options.Port), err);
+        if (!err) asio::connect(c->Socket, endpoints, err);
+        if (!err) c->Socket.set_option(tcp::no_delay(true), err);
+        if (err) {
+            Connection = nullptr;
+            return false;
+        }
+
+        c->Open = true;
+        c->read();
+        c->Thread = std::thread{[c]() {
+            auto guard = asio::make_work_guard(c->IO);
+            c->IO.run();
+        }};
+
+        // a server that does not answer in time is hung up on.
+        auto answer = [this](std::future<response> f) -> response {
+            if (f.wait_for(Options.Timeout) == std::future_status::ready) return f.get();
+            stop();
+            return response{};
+        };
+
+        mining::subscribe_response subscribed{answer(send(mining_subscribe, {Options.UserAgent}))};
+        if (!subscribed.valid()) {
+            stop();
+            return false;
+        }
+
+        ExtraNonce1 = subscribed.extra_nonce_1();
+        ExtraNonce2Size = subscribed.extra_nonce_2_size();
+
+        mining::authorize_request::parameters p{Options.Username};
+        p.Password = Options.Password;
+        response authorized = answer(send(mining_authorize, mining::authorize_request::serialize(p)));
+        if (authorized.is_error() || authorized.result() != true) {
+            stop();
+            return false;
+        }
+
+        return true;
+    }
+
+    void client::stop() {
+        if (Connection == nullptr) return;
+        connection* c = Connection.get();
+
+        {
+            std::lock_guard<std::mutex> lock{c->Mutex};
+            if (c->Stopped) return;
+            c->Stopped = true;
+        }
+
+        asio::post(c->IO, [c]() {
+            c->close();
+            c->IO.stop();
+        });
+
+        if (c->Thread.joinable()) c->Thread.join();
+
+        // requests that were posted before the connection was stopped fail now.
+        c->IO.restart();
+        c->IO.poll();
+        c->close();
+    }
+
+    bool client::connected() const {
+        return Connection != nullptr && Connection->Open;
+    }
+
+    session_id client::extra_nonce_1() const {
+        return ExtraNonce1;
+    }
+
+    uint32 client::extra_nonce_2_size() const {
+        return ExtraNonce2Size;
+    }
+
+    difficulty client::share_difficulty() const {
+        return difficulty{Difficulty.load()};
+    }
+
+    uint32 client::pending() const {
+        return Pending;
+    }
+
+    void client::send(method m, const parameters& p, handler h) {
+        request_id id = NextID++;
+        send(id, std::make_shared<const string>(request{id, m, p}.dump() + "\n"), std::move(h));
+    }
+
+    void client::send(request_id id, std::shared_ptr<const string> x, handler h) {
+        Pending++;
+
+        connection* c = Connection.get();
+        if (c != nullptr) {
+            std::lock_guard<std::mutex> lock{c->Mutex};
+            if (!c->Stopped) {
+                asio::post(c->IO, [c, id, x, h]() {
+                    c->send(id, x, h);
+                });
+                return;
+            }
+        }
+
+        Pending--;
+        h(response{});
+    }
+
+    std::future<response> client::send(method m, const parameters& p) {
+        auto promise = std::make_shared<std::promise<response>>();
+        send(m, p, [promise](const response& r) {
+            promise->set_value(r);
+        });
+        return promise->get_future();
+    }
+
+    void client::submit(const share& x, std::function<void(bool)> f) {
+        request_id id = NextID++;
+        auto message = std::make_shared<string>();
+        codec::encode(*message, id, x);
+        message->push_back('\n');
+        send(id, std::move(message), [f](const response& r) {
+            f(!r.is_error() && r.result() == true);
+        });
+    }
+
+    std::future<bool> client::submit(const share& x) {
+        auto promise = std::make_shared<std::promise<bool>>();
+        submit(x, [promise](bool accepted) {
+            promise->set_value(accepted);
+        });
+        return promise->get_future();
+    }
+
+}
@@ -0,0 +1,382 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/codec.hpp>
+#include <charconv>
+
+namespace Gigamonkey::Stratum::codec {
+
+    namespace {
+
+        int digit(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        bool unhex(string_view s, byte* x) {
+            for (size_t i = 0; i < s.size(); i += 2) {
+                int a = digit(s[i]);
+                int b = digit(s[i + 1]);
+                if (a < 0 || b < 0) return false;
+                x[i / 2] = static_cast<byte>(a << 4 | b);
+            }
+            return true;
+        }
+
+        struct reader {
+            const char* It;
+            const char* End;
+
+            reader(string_view x) : It{x.data()}, End{x.data() + x.size()} {}
+
+            void space() {
+                while (It != End && (*It == ' ' || *It == '\t' || *It == '\n' || *It == '\r')) It++;
+            }
+
+            bool done() {
+                space();
+                return It == End;
+            }
+
+            bool read(char c) {
+                space();
+                if (It == End || *It != c) return false;
+                It++;
+                return true;
+            }
+
+            bool literal(string_view x) {
+                space();
+                if (size_t(End - It) < x.size() || string_view{It, x.size()} != x) return false;
+                It += x.size();
+                return true;
+            }
+
+            // a string without escapes, which is all that keys,
+            // method names, and hex strings ever need.
+            bool raw(string_view& x) {
+                if (!read('"')) return false;
+                const char* begin = It;
+                while (It != End && *It != '"') {
+                    if (*It == '\\' || static_cast<unsigned char>(*It) < 0x20) return false;
+                    It++;
+                }
+
+                if (It == End) return false;
+                x = string_view{begin, size_t(It - begin)};
+                It++;
+                return true;
+            }
+
+            bool text(string& x) {
+                if (!read('"')) return false;
+                x.clear();
+                while (It != End) {
+                    char c = *It++;
+                    if (c == '"') return true;
+                    if (static_cast<unsigned char>(c) < 0x20) return false;
+                    if (c != '\\') {
+                        x.push_back(c);
+                        continue;
+                    }
+
+                    if (It == End) return false;
+                    switch (*It++) {
+                        case '"': x.push_back('"'); break;
+                        case '\\': x.push_back('\\'); break;
+                        case '/': x.push_back('/'); break;
+                        case 'b': x.push_back('\b'); break;
+                        case 'f': x.push_back('\f'); break;
+                        case 'n': x.push_back('\n'); break;
+                        case 'r': x.push_back('\r'); break;
+                        case 't': x.push_back('\t'); break;
+                        default: return false;
+                    }
+                }
+
+                return false;
+            }
+
+            bool number(uint64& x) {
+                space();
+                auto r = std::from_chars(It, End, x);
+                if (r.ec != std::errc{} || r.ptr == It) return false;
+                It = r.ptr;
+                return true;
+            }
+
+            bool boolean(bool& x) {
+                if (literal("true")) x = true;
+                else if (literal("false")) x = false;
+                else return false;
+                return true;
+            }
+
+            // exactly size bytes in hex.
+            bool hex(byte* x, size_t size) {
+                string_view s;
+                return raw(s) && s.size() == 2 * size && unhex(s, x);
+            }
+
+            bool hex(bytes& x) {
+                string_view s;
+                if (!raw(s) || s.size() % 2 != 0) return false;
+                x.resize(s.size() / 2);
+                return unhex(s, x.data());
+            }
+
+            // four bytes in hex representing a big-endian number.
+            bool big(uint32& x) {
+                byte b[4];
+                if (!hex(b, 4)) return false;
+                x = uint32(b[0]) << 24 | uint32(b[1]) << 16 | uint32(b[2]) << 8 | uint32(b[3]);
+                return true;
+            }
+
+            // any value, which is read and ignored.
+            bool skip() {
+                space();
+                if (It == End) return false;
+
+                if (*It == '"') {
+                    for (It++; It != End && *It != '"'; It++) if (*It == '\\' && ++It == End) return false;
+                    if (It == End) return false;
+                    It++;
+                    return true;
+                }
+
+                if (*It == '[' || *It == '{') {
+                    uint32 depth = 0;
+                    for (; It != End; It++) {
+                        if (*It == '"') {
+                            if (!skip()) return false;
+                            It--;
+                        } else if (*It == '[' || *It == '{') depth++;
+                        else if ((*It == ']' || *It == '}') && --depth == 0) {
+                            It++;
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                const char* begin = It;
+                while (It != End && *It != ',' && *It != ']' && *It != '}' &&
+                    *It != ' ' && *It != '\t' && *It != '\n' && *It != '\r') It++;
+                return It != begin;
+            }
+        };
+
+        // calls field with each key, which must read the value that follows it.
+        template <typename f>
+        bool object(reader& r, f field) {
+            if (!r.read('{')) return false;
+            if (r.read('}')) return true;
+            do {
+                string_view key;
+                if (!r.raw(key) || !r.read(':') || !field(key)) return false;
+            } while (r.read(','));
+            return r.read('}');
+        }
+
+        bool method(reader& r, string_view expected) {
+            string_view x;
+            return r.raw(x) && x == expected;
+        }
+
+        constexpr char Digits[] = "0123456789abcdef";
+
+        void hex(char* o, const byte* x, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                *o++ = Digits[x[i] >> 4];
+                *o++ = Digits[x[i] & 15];
+            }
+        }
+
+        void hex(string& o, const byte* x, size_t size) {
+            o.push_back('"');
+            size_t n = o.size();
+            o.resize(n + 2 * size);
+            hex(&o[n], x, size);
+            o.push_back('"');
+        }
+
+        void big(string& o, uint32 x) {
+            byte b[4]{byte(x >> 24), byte(x >> 16), byte(x >> 8), byte(x)};
+            hex(o, b, 4);
+        }
+
+        void number(string& o, uint64 x) {
+            char b[20];
+            auto r = std::to_chars(b, b + 20, x);
+            o.append(b, r.ptr);
+        }
+
+        // escaped the same way as nlohmann::json.
+        void text(string& o, const string& x) {
+            o.push_back('"');
+            for (char c : x) switch (c) {
+                case '"': o.append("\\\""); break;
+                case '\\': o.append("\\\\"); break;
+                case '\b': o.append("\\b"); break;
+                case '\f': o.append("\\f"); break;
+                case '\n': o.append("\\n"); break;
+                case '\r': o.append("\\r"); break;
+                case '\t': o.append("\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(c) >= 0x20) o.push_back(c);
+                    else {
+                        o.append("\\u00");
+                        o.push_back(Digits[c >> 4]);
+                        o.push_back(Digits[c & 15]);
+                    }
+            }
+            o.push_back('"');
+        }
+
+        bool submit_params(reader& r, share& x) {
+            uint32 id, timestamp, n;
+            if (!(r.read('[') && r.text(x.Name) && r.read(',') &&
+                r.big(id) && r.read(',') &&
+                r.hex(x.Share.ExtraNonce2.data(), 8) && r.read(',') &&
+                r.big(timestamp) && r.read(',') &&
+                r.big(n) && r.read(']'))) return false;
+
+            x.JobID = id;
+            x.Share.Timestamp = Bitcoin::timestamp(timestamp);
+            x.Share.Nonce = n;
+            return true;
+        }
+
+        bool path(reader& r, Merkle::digests& x) {
+            x = Merkle::digests{};
+            if (!r.read('[')) return false;
+            if (r.read(']')) return true;
+            do {
+                uint256 d;
+                if (!r.hex(d.data(), 32)) return false;
+                x = x << digest256{d};
+            } while (r.read(','));
+            return r.read(']');
+        }
+
+        bool notify_params(reader& r, mining::notify::parameters& p) {
+            uint32 id, version, target, now;
+            if (!(r.read('[') &&
+                r.big(id) && r.read(',') &&
+                r.hex(p.Digest.data(), 32) && r.read(',') &&
+                r.hex(p.GenerationTx1) && r.read(',') &&
+                r.hex(p.GenerationTx2) && r.read(',') &&
+                path(r, p.Path) && r.read(',') &&
+                r.big(version) && r.read(',') &&
+                r.big(target) && r.read(',') &&
+                r.big(now) && r.read(',') &&
+                r.boolean(p.Clean) && r.read(']'))) return false;
+
+            p.ID = id;
+            p.Version = int32_little{static_cast<int32>(version)};
+            p.Target = work::compact{target};
+            p.Now = Bitcoin::timestamp(now);
+            return true;
+        }
+
+    }
+
+    bool decode(string_view m, request_id& id, share& x) {
+        reader r{m};
+        bool has_id = false;
+        bool has_method = false;
+        bool has_params = false;
+        return object(r, [&r, &id, &x, &has_id, &has_method, &has_params](string_view key) {
+            if (key == "id") return has_id = r.number(id);
+            if (key == "method") return has_method = method(r, "mining.submit");
+            if (key == "params") return has_params = submit_params(r, x);
+            return r.skip();
+        }) && r.done() && has_id && has_method && has_params;
+    }
+
+    bool decode(string_view m, mining::notify::parameters& p) {
+        reader r{m};
+        bool has_id = false;
+        bool has_method = false;
+        bool has_params = false;
+        return object(r, [&r, &p, &has_id, &has_method, &has_params](string_view key) {
+            if (key == "id") return has_id = r.literal("null");
+            if (key == "method") return has_method = method(r, "mining.notify");
+            if (key == "params") return has_params = notify_params(r, p);
+            return r.skip();
+        }) && r.done() && has_id && has_method && has_params;
+    }
+
+    bool decode(string_view m, request_id& id, bool& result) {
+        reader r{m};
+        bool has_id = false;
+        bool has_error = false;
+        bool has_result = false;
+        return object(r, [&r, &id, &result, &has_id, &has_error, &has_result](string_view key) {
+            if (key == "id") return has_id = r.number(id);
+            if (key == "error") return has_error = r.literal("null");
+            if (key == "result") return has_result = r.boolean(result);
+            return r.skip();
+        }) && r.done() && has_id && has_error && has_result;
+    }
+
+    void encode(string& o, request_id id, const share& x) {
+        o.append("{\"id\":");
+        number(o, id);
+        o.append(",\"method\":\"mining.submit\",\"params\":[");
+        text(o, x.Name);
+        o.push_back(',');
+        big(o, x.JobID);
+        o.push_back(',');
+        hex(o, x.Share.ExtraNonce2.data(), 8);
+        o.push_back(',');
+        big(o, uint32(x.Share.Timestamp.Value));
+        o.push_back(',');
+        big(o, uint32(x.Share.Nonce));
+        o.append("]}");
+    }
+
+    void encode(string& o, const mining::notify::parameters& p) {
+        o.append("{\"id\":null,\"method\":\"mining.notify\",\"params\":[");
+        big(o, p.ID);
+        o.push_back(',');
+        hex(o, p.Digest.data(), 32);
+        o.push_back(',');
+        hex(o, p.GenerationTx1.data(), p.GenerationTx1.size());
+        o.push_back(',');
+        hex(o, p.GenerationTx2.data(), p.GenerationTx2.size());
+        o.append(",[");
+
+        // the path is written starting from the last element of the stack.
+        size_t size = p.Path.size();
+        if (size > 0) {
+            size_t begin = o.size();
+            o.resize(begin + size * 67 - 1, ',');
+            size_t i = size;
+            for (Merkle::digests d = p.Path; !d.empty(); d = d.rest()) {
+                char* at = &o[begin + --i * 67];
+                at[0] = '"';
+                hex(at + 1, d.first().Value.data(), 32);
+                at[65] = '"';
+            }
+        }
+
+        o.append("],");
+        big(o, uint32(int32(p.Version)));
+        o.push_back(',');
+        big(o, uint32(uint32_little(p.Target)));
+        o.push_back(',');
+        big(o, uint32(p.Now.Value));
+        o.append(p.Clean ? ",true]}" : ",false]}");
+    }
+
+    void encode(string& o, request_id id, bool result) {
+        o.append("{\"error\":null,\"id\":");
+        number(o, id);
+        o.append(result ? ",\"result\":true}" : ",\"result\":false}");
+    }
+
+}
@@ -1,14 +1,77 @@
 
 #include <gigamonkey/stratum/difficulty.hpp>
+#include <limits>
 
 namespace Gigamonkey::Stratum {
+    
+    // 256 bit division in base_uint goes one bit at a time. Instead, we
+    // estimate quotients from the leading 64 bits of each number and
+    // correct the estimate with multiplication, or divide 64 bits at a time.
+    // Either way the result is exact.
+    namespace {
+        
+        // whether q * t is greater than n. 
+        bool exceeds(uint64 q, const work::words& t, const work::words& n) {
+            uint64 product[4];
+            unsigned __int128 carry = 0;
+            for (int i = 0; i < 4; i++) {
+                carry += static_cast<unsigned __int128>(q) * t[i];
+                product[i] = static_cast<uint64>(carry);
+                carry >>= 64;
+            }
+            
+            if (carry != 0) return true;
+            for (int i = 3; i >= 0; i--) if (product[i] != n[i]) return product[i] > n[i];
+            return false;
+        }
+        
+        // n / d, one word at a time. 
+        work::words divide(const work::words& n, uint64 d) {
+            work::words q;
+            unsigned __int128 r = 0;
+            for (int i = 3; i >= 0; i--) {
+                r = (r << 64) | n[i];
+                q[i] = static_cast<uint64>(r / d);
+                r %= d;
+            }
+            return q;
+        }
+        
+        // the lower 64 bits of n / t. 
+        uint64 quotient(const uint256& n, const uint256& t) {
+            uint64 mn, mt;
+            int bn = work::leading(n, mn);
+            int bt = work::leading(t, mt);
+            if (bt == 0 || bn < bt) return 0;
+            
+            // the estimate is between 2^62 and 2^64. Its relative error is 
+            // less than 2^-61, so q is off by a few at most. 
+            uint64 estimate = static_cast<uint64>((static_cast<unsigned __int128>(mn) << 63) / mt);
+            int shift = bn - bt - 63;
+            
+            uint64 q;
+            if (shift <= -64) q = 0;
+            else if (shift < 0) q = estimate >> -shift;
+            else if (shift == 0) q = estimate;
+            // a quotient that doesn't fit in 64 bits never happens with real difficulties. 
+            else if (shift >= 64 || (estimate >> (64 - shift)) != 0) return (n / t).GetLow64();
+            else q = estimate << shift;
+            
+            work::words ln = work::to_words(n);
+            work::words lt = work::to_words(t);
+            while (q > 0 && exceeds(q, lt, ln)) q--;
+            while (q < std::numeric_limits<uint64>::max() && !exceeds(q + 1, lt, ln)) q++;
+            return q;
+        }
+        
+    }
 
     template <uint32_t DiffOneBits, size_t TableSize = 64>
     struct Difficulty {
         static const uint64_t GetDiffOneBits() { return DiffOneBits; }
 
         static const uint256 &GetDiffOneTarget() {
-            static const auto DiffOneTarget = work::compact(DiffOneBits).expand();
+            static const auto DiffOneTarget = work::from_words(work::expand_words(DiffOneBits));
             return DiffOneTarget;
         }
 
@@ -27,7 +90,7 @@ namespace Gigamonkey::Stratum {
         }
 
         static difficulty TargetToDiff(const uint256 &target) {
-            return difficulty{(GetDiffOneTarget() / target).GetLow64()};
+            return difficulty{quotient(GetDiffOneTarget(), target)};
         }
 
         static void DiffToTarget(difficulty diff, Gigamonkey::uint256 &target) {
@@ -47,7 +110,7 @@ namespace Gigamonkey::Stratum {
             }
 
             // If it is not found in the table, it will be calculated.
-            target = GetDiffOneTarget() / uint64(diff);
+            target = work::from_words(divide(work::to_words(GetDiffOneTarget()), uint64(diff)));
         }
     };
 
@@ -5,7 +5,15 @@
 
 namespace Gigamonkey::Stratum {
     
-    std::string error_message_from_code(error_code) {
-        return "";
+    std::string error_message_from_code(error_code e) {
+        switch (e) {
+            case other: return "Other/Unknown";
+            case job_not_found: return "Job not found";
+            case duplicate_share: return "Duplicate share";
+            case low_difficulty_share: return "Low difficulty share";
+            case unauthorized_worker: return "Unauthorized worker";
+            case not_subscribed: return "Not subscribed";
+            default: return "";
+        }
     }
 }
@@ -0,0 +1,136 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/job_registry.hpp>
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace Gigamonkey::Stratum {
+
+    job_registry::entry::entry(const mining::notify::parameters& n, uint32 max_shares, uint64 seed) :
+        ID{n.ID}, Puzzle{work::puzzle(n)}, Now{n.Now},
+        Coinbase{bytes_view(n.GenerationTx1)}, Path{}, Shares{max_shares, seed}, Size{0} {
+        for (Merkle::digests d = n.Path; !d.empty(); d = d.rest()) Path.push_back(d.first());
+        Size = sizeof(entry) + Puzzle.Header.size() + Puzzle.Body.size() +
+            2 * Path.size() * sizeof(digest256) + Shares.memory();
+    }
+
+    digest256 job_registry::entry::merkle_root(const session_id& n1, const uint64_big& n2) const {
+        bytes_view parts[3]{
+            bytes_view{n1.data(), 4},
+            bytes_view{n2.data(), 8},
+            bytes_view(Puzzle.Body)};
+
+        digest256 root = Coinbase(parts, 3);
+
+        // the coinbase is always on the left.
+        byte pair[64];
+        for (const digest256& d : Path) {
+            std::memcpy(pair, root.Value.data(), 32);
+            std::memcpy(pair + 32, d.Value.data(), 32);
+            root = Bitcoin::hash256(bytes_view{pair, 64});
+        }
+
+        return root;
+    }
+
+    void job_registry::table::erase(job_id id) {
+        auto old = Jobs.find(id);
+        Size -= old->second->Size;
+        Jobs.erase(old);
+        Order.erase(std::find(Order.begin(), Order.end(), id));
+    }
+
+    void job_registry::table::retire(job_id id, uint32 max) {
+        if (max == 0) return;
+        if (Retired.insert(id).second) RetiredOrder.push_back(id);
+        while (RetiredOrder.size() > max) {
+            Retired.erase(RetiredOrder.front());
+            RetiredOrder.pop_front();
+        }
+    }
+
+    job_registry::job_registry(size_t max_size, uint32 max_retired, uint32 max_shares) :
+        MaxSize{max_size}, MaxRetired{max_retired}, MaxShares{max_shares}, Mutex{},
+        Table{new table{}}, Readers{} {}
+
+    job_registry::~job_registry() {
+        delete Table.load();
+    }
+
+    void job_registry::publish(const table* next) {
+        const table* last = Table.exchange(next);
+        Readers.wait();
+        delete last;
+    }
+
+    bool job_registry::notify(const mining::notify::parameters& n) {
+        if (!n.valid()) return false;
+        static thread_local std::mt19937_64 random{std::random_device{}()};
+        auto x = std::make_shared<const entry>(n, MaxShares, random());
+
+        std::lock_guard<std::mutex> lock{Mutex};
+        const table* last = Table.load();
+        auto next = std::make_unique<table>();
+
+        if (n.Clean) {
+            next->Retired = last->Retired;
+            next->RetiredOrder = last->RetiredOrder;
+            for (job_id id : last->Order) next->retire(id, MaxRetired);
+        } else *next = *last;
+
+        // a job with the same id as one we already have replaces it.
+        if (next->Jobs.count(n.ID) != 0) next->erase(n.ID);
+
+        // an id that is used again is no longer stale.
+        if (next->Retired.erase(n.ID))
+            next->RetiredOrder.erase(std::find(next->RetiredOrder.begin(), next->RetiredOrder.end(), n.ID));
+
+        next->Jobs[n.ID] = x;
+        next->Order.push_back(n.ID);
+        next->Size += x->Size;
+
+        // the newest job is kept even if it is bigger than max size by itself.
+        while (next->Size > MaxSize && next->Order.size() > 1) {
+            job_id id = next->Order.front();
+            next->erase(id);
+            next->retire(id, MaxRetired);
+        }
+
+        publish(next.release());
+        return true;
+    }
+
+    bool job_registry::remove(job_id id) {
+        std::lock_guard<std::mutex> lock{Mutex};
+        const table* last = Table.load();
+        if (last->Jobs.count(id) == 0) return false;
+
+        auto next = std::make_unique<table>(*last);
+        next->erase(id);
+        next->retire(id, MaxRetired);
+
+        publish(next.release());
+        return true;
+    }
+
+    job_registry::lookup job_registry::find(job_id id) const {
+        readers::reader r{Readers};
+        const table& t = *Table.load();
+        auto j = t.Jobs.find(id);
+        if (j != t.Jobs.end()) return lookup{found, j->second};
+        return lookup{t.Retired.count(id) != 0 ? stale : unknown};
+    }
+
+    size_t job_registry::jobs() const {
+        readers::reader r{Readers};
+        return Table.load()->Jobs.size();
+    }
+
+    size_t job_registry::size() const {
+        readers::reader r{Readers};
+        return Table.load()->Size;
+    }
+
+}
@@ -54,7 +54,7 @@ namespace Gigamonkey::Stratum::mining {
         
         parameters write(const Merkle::digests& x) {
             parameters p;
-            Merkle::digests n;
+            Merkle::digests n = x;
             p.resize(x.size());
             for (auto it = p.rbegin(); it != p.rend(); ++it) { 
                 *it = write(n.first().Value);
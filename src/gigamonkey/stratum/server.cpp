@@ -0,0 +1,388 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/server.hpp>
+#include <gigamonkey/stratum/codec.hpp>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <unordered_set>
+#include <deque>
+#include <mutex>
+
+namespace Gigamonkey::Stratum {
+
+    namespace asio = boost::asio;
+    using tcp = asio::ip::tcp;
+
+    namespace {
+        std::shared_ptr<const string> line(const json& j) {
+            return std::make_shared<const string>(j.dump() + "\n");
+        }
+
+        // the most messages that are written at once, which is as
+        // many as asio will give to the system in one call.
+        constexpr size_t MaxBuffers = 64;
+    }
+
+    struct server::context {
+        asio::io_context IO;
+        tcp::acceptor Acceptor;
+
+        // only touched from the thread that runs IO.
+        std::unordered_set<std::shared_ptr<session>> Sessions;
+
+        // the latest job, already serialized. Each context has its own
+        // copy, which is replaced on its own thread.
+        std::shared_ptr<const string> Job;
+
+        context() : IO{1}, Acceptor{IO}, Sessions{}, Job{} {}
+    };
+
+    struct server::session : std::enable_shared_from_this<session> {
+        enum state {
+            connected,
+            subscribed,
+            authorized
+        };
+
+        server& Server;
+        context& Context;
+        tcp::socket Socket;
+        asio::streambuf Input;
+
+        state State;
+        bool Closed;
+        worker Worker;
+
+        // messages waiting to be written. Broadcast messages are shared
+        // by every session, so they are queued by reference.
+        std::deque<std::shared_ptr<const string>> Output;
+        size_t Queued;
+
+        // the messages at the front of Output that are being written.
+        size_t Writing;
+        std::vector<asio::const_buffer> Buffers;
+
+        // reused for every share that the worker submits.
+        share Submitted;
+
+        session(server& s, context& c, tcp::socket x) : Server{s}, Context{c}, Socket{std::move(x)},
+            Input{s.Options.MaxMessageSize}, State{connected}, Closed{false},
+            Worker{{}, session_id{s.ExtraNonce1++}}, Output{}, Queued{0}, Writing{0}, Buffers{}, Submitted{} {}
+
+        void read();
+        void receive(const string& message);
+        void respond(const request& r);
+        void submit(request_id, const share&);
+        void send(std::shared_ptr<const string>);
+        void write();
+        void close();
+
+        void error(request_id id, error_code e) {
+            send(line(response{id, nullptr, Stratum::error{e}}));
+        }
+    };
+
+    void server::session::read() {
+        auto self = shared_from_this();
+        asio::async_read_until(Socket, Input, '\n', [self](const boost::system::error_code& err, size_t n) {
+            // an error here includes a message that does not fit in the buffer.
+            if (err || self->Closed) return self->close();
+
+            auto data = self->Input.data();
+            string message(asio::buffers_begin(data), asio::buffers_begin(data) + n - 1);
+            self->Input.consume(n);
+
+            self->receive(message);
+            if (!self->Closed) self->read();
+        });
+    }
+
+    void server::session::receive(const string& message) {
+        if (message.empty() || message == "\r") return;
+
+        // shares make up most of the traffic, so they are read without the json types.
+        request_id id;
+        if (State == authorized && codec::decode(message, id, Submitted)) {
+            try {
+                return submit(id, Submitted);
+            } catch (...) {
+                return close();
+            }
+        }
+
+        json j = json::parse(message, nullptr, false);
+        if (j.is_discarded()) return close();
+
+        // responses from the client are ignored.
+        if (response::valid(j)) return;
+
+        // a message that cannot be answered means that the client does not speak Stratum.
+        if (!j.is_object() || !j.contains("id") || !j["id"].is_number_unsigned()) return close();
+
+        request r{j};
+        if (!r.valid()) return error(r.id(), other);
+
+        try {
+            respond(r);
+        } catch (...) {
+            close();
+        }
+    }
+
+    void server::session::respond(const request& r) {
+        switch (r.method()) {
+            case mining_subscribe: {
+                if (!mining::subscribe_request::valid(r)) return error(r.id(), other);
+                if (State == connected) State = subscribed;
+                session_id n1 = Worker.ExtraNonce1;
+                return send(line(mining::subscribe_response{r.id(),
+                    {mining::subscription{mining_set_difficulty, n1}, mining::subscription{mining_notify, n1}},
+                    n1, worker::ExtraNonce2_size}));
+            }
+
+            case mining_authorize: {
+                if (State == connected) return error(r.id(), not_subscribed);
+                auto p = mining::authorize_request::deserialize(r.params());
+                if (!p.valid()) return error(r.id(), other);
+                if (State == authorized && p.Username != Worker.Name) return error(r.id(), unauthorized_worker);
+
+                worker w{p.Username, Worker.ExtraNonce1};
+                bool ok = Server.Pool.authorize(w, p);
+                send(line(boolean_response{r.id(), ok}));
+                if (!ok || State == authorized) return;
+
+                State = authorized;
+                Worker = w;
+                send(line(mining::set_difficulty{Server.Options.Difficulty}));
+                if (Context.Job != nullptr) send(Context.Job);
+                return;
+            }
+
+            case mining_submit: {
+                if (State != authorized) return error(r.id(), unauthorized_worker);
+                share x = mining::submit_request::deserialize(r.params());
+                if (!x.valid()) return error(r.id(), other);
+                return submit(r.id(), x);
+            }
+
+            default: return error(r.id(), other);
+        }
+    }
+
+    void server::session::submit(request_id id, const share& x) {
+        if (x.Name != Worker.Name) return error(id, unauthorized_worker);
+        auto response = std::make_shared<string>();
+        codec::encode(*response, id, Server.Pool.submit(Worker, x));
+        response->push_back('\n');
+        send(std::move(response));
+    }
+
+    void server::session::send(std::shared_ptr<const string> x) {
+        if (Closed) return;
+        if (Queued + x->size() > Server.Options.MaxQueueSize) return close();
+        Queued += x->size();
+        Output.push_back(std::move(x));
+        if (Writing == 0) write();
+    }
+
+    // one write is in progress at a time. Everything that is queued when
+    // it starts is written together with a single gather write.
+    void server::session::write() {
+        Writing = std::min(Output.size(), MaxBuffers);
+        Buffers.clear();
+        for (size_t i = 0; i < Writing; i++) Buffers.push_back(asio::buffer(*Output[i]));
+
+        auto self = shared_from_this();
+        asio::async_write(Socket, Buffers, [self](const boost::system::error_code& err, size_t n) {
+            if (err || self->Closed) return self->close();
+            self->Queued -= n;
+            self->Output.erase(self->Output.begin(), self->Output.begin() + self->Writing);
+            self->Writing = 0;
+            if (!self->Output.empty()) self->write();
+        });
+    }
+
+    void server::session::close() {
+        if (Closed) return;
+        Closed = true;
+        boost::system::error_code err;
+        Socket.shutdown(tcp::socket::shutdown_both, err);
+        Socket.close(err);
+        Output.clear();
+        Queued = 0;
+        Writing = 0;
+        Server.Sessions--;
+        // may destroy this session if no handler holds it.
+        Context.Sessions.erase(shared_from_this());
+    }
+
+    namespace {
+        // how long to wait before accepting again after an error.
+        constexpr std::chrono::milliseconds AcceptRetry{100};
+
+        // accept connections on one socket. Each new connection is
+        // given to the context that choose returns.
+        template <typename choose, typename f>
+        void accept(tcp::acceptor& a, choose next, f open) {
+            auto c = next();
+            a.async_accept(c->IO, [&a, next, open, c](const boost::system::error_code& err, tcp::socket x) {
+                if (err == asio::error::operation_aborted || !a.is_open()) return;
+
+                // most likely we are out of file descriptors, which will not
+                // change if we try again right away.
+                if (err) {
+                    auto timer = std::make_shared<asio::steady_timer>(a.get_executor(), AcceptRetry);
+                    timer->async_wait([&a, next, open, timer](const boost::system::error_code& err) {
+                        if (err || !a.is_open()) return;
+                        accept(a, next, open);
+                    });
+                    return;
+                }
+
+                auto s = std::make_shared<tcp::socket>(std::move(x));
+                asio::post(c->IO, [open, c, s]() {
+                    open(*c, std::move(*s));
+                });
+                accept(a, next, open);
+            });
+        }
+    }
+
+    server::server(pool& p, const options& o) : Pool{p}, Options{o}, Contexts{}, Threads{},
+        ExtraNonce1{1}, Sessions{0}, Mutex{}, Job{}, Port{0} {
+        if (Options.Threads == 0) Options.Threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    server::~server() {
+        stop();
+    }
+
+    bool server::start() {
+        if (!Contexts.empty()) return false;
+
+        boost::system::error_code err;
+        auto address = asio::ip::make_address(Options.Address, err);
+        if (err) return false;
+
+        for (uint32 i = 0; i < Options.Threads; i++) Contexts.push_back(std::make_unique<context>());
+
+        {
+            std::lock_guard<std::mutex> lock{Mutex};
+            for (auto& c : Contexts) c->Job = Job;
+        }
+
+#ifdef SO_REUSEPORT
+        uint32 listeners = Options.Threads;
+#else
+        uint32 listeners = 1;
+#endif
+
+        // the first socket chooses the port if none was given.
+        tcp::endpoint endpoint{address, Options.Port};
+        for (uint32 i = 0; i < listeners; i++) {
+            tcp::acceptor& a = Contexts[i]->Acceptor;
+            a.open(endpoint.protocol(), err);
+            if (!err) a.set_option(tcp::acceptor::reuse_address(true), err);
+#ifdef SO_REUSEPORT
+            if (!err) a.set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true), err);
+#endif
+            if (!err) a.bind(endpoint, err);
+            if (!err) a.listen(asio::socket_base::max_listen_connections, err);
+            if (err) {
+                Contexts.clear();
+                return false;
+            }
+
+            if (i == 0) endpoint = a.local_endpoint();
+        }
+
+        Port = endpoint.port();
+
+        auto open = [this](context& c, tcp::socket x) {
+            // the connection may have been reset already.
+            boost::system::error_code err;
+            x.set_option(tcp::no_delay(true), err);
+            if (err) return;
+
+            Sessions++;
+            auto s = std::make_shared<session>(*this, c, std::move(x));
+            c.Sessions.insert(s);
+            s->read();
+        };
+
+        if (listeners == Options.Threads) for (auto& c : Contexts) {
+            context* p = c.get();
+            accept(p->Acceptor, [p]() {
+                return p;
+            }, open);
+        } else {
+            // without SO_REUSEPORT, one socket hands connections to each thread in turn.
+            auto next = std::make_shared<uint32>(0);
+            accept(Contexts[0]->Acceptor, [this, next]() {
+                return Contexts[(*next)++ % Contexts.size()].get();
+            }, open);
+        }
+
+        for (auto& c : Contexts) {
+            context* p = c.get();
+            Threads.emplace_back([p]() {
+                // keep running until the server is stopped, even with no connections.
+                auto guard = asio::make_work_guard(p->IO);
+                p->IO.run();
+            });
+        }
+
+        return true;
+    }
+
+    void server::stop() {
+        for (auto& c : Contexts) {
+            context* p = c.get();
+            asio::post(p->IO, [p]() {
+                boost::system::error_code err;
+                p->Acceptor.close(err);
+                auto sessions = p->Sessions;
+                for (auto& s : sessions) s->close();
+                p->IO.stop();
+            });
+        }
+
+        for (std::thread& t : Threads) t.join();
+        Threads.clear();
+        Contexts.clear();
+    }
+
+    uint16 server::port() const {
+        return Port;
+    }
+
+    uint32 server::sessions() const {
+        return Sessions;
+    }
+
+    // the job is written once and every session is sent the same buffer.
+    void server::notify(const mining::notify::parameters& p) {
+        auto message = std::make_shared<string>();
+        codec::encode(*message, p);
+        message->push_back('\n');
+        std::shared_ptr<const string> job{std::move(message)};
+
+        // jobs are posted in the same order to every context.
+        std::lock_guard<std::mutex> lock{Mutex};
+        Job = job;
+        for (auto& c : Contexts) {
+            context* x = c.get();
+            asio::post(x->IO, [x, job]() {
+                x->Job = job;
+
+                // a session that cannot keep up is closed and removed as we go.
+                for (auto it = x->Sessions.begin(); it != x->Sessions.end();) {
+                    auto s = *it++;
+                    if (s->State == session::authorized) s->send(job);
+                }
+            });
+        }
+    }
+
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/stats.hpp>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <string>
+
+namespace Gigamonkey::Stratum {
+
+    namespace {
+        void add(std::atomic<double>& x, double d) {
+            double v = x.load(std::memory_order_relaxed);
+            while (!x.compare_exchange_weak(v, v + d, std::memory_order_relaxed));
+        }
+    }
+
+    share_stats::share_stats(clock::time_point start, double width) : Width{width}, Start{start},
+        Accepted{0}, Rejected{0}, Duplicate{0}, Stale{0}, Work{0}, Window{} {}
+
+    double share_stats::seconds(clock::time_point now) const {
+        return std::chrono::duration<double>(now - Start).count();
+    }
+
+    // epochs start at 1 so that a bucket with epoch 0 has never been used.
+    uint64 share_stats::epoch(clock::time_point now) const {
+        double t = seconds(now);
+        if (t < 0) return 1;
+        return static_cast<uint64>(std::floor(t / Width)) + 1;
+    }
+
+    void share_stats::record(share_status status, work::difficulty d, clock::time_point now) {
+        switch (status) {
+            case share_accepted: break;
+            case share_duplicate: Duplicate.fetch_add(1, std::memory_order_relaxed); return;
+            case share_stale: Stale.fetch_add(1, std::memory_order_relaxed); return;
+            default: Rejected.fetch_add(1, std::memory_order_relaxed); return;
+        }
+
+        Accepted.fetch_add(1, std::memory_order_relaxed);
+        add(Work, d.Value);
+
+        uint64 e = epoch(now);
+        bucket& b = Window[e % Buckets];
+        uint64 old = b.Epoch.load(std::memory_order_acquire);
+        while (old < e) if (b.Epoch.compare_exchange_weak(old, e, std::memory_order_acq_rel)) {
+            b.Work.store(0, std::memory_order_release);
+            old = e;
+        }
+
+        // a bucket that has already moved on belongs to a later time than this share.
+        if (old == e) add(b.Work, d.Value);
+    }
+
+    share_counts share_stats::read(clock::time_point now) const {
+        share_counts x;
+        x.Accepted = Accepted.load(std::memory_order_relaxed);
+        x.Rejected = Rejected.load(std::memory_order_relaxed);
+        x.Duplicate = Duplicate.load(std::memory_order_relaxed);
+        x.Stale = Stale.load(std::memory_order_relaxed);
+        x.Work = work::difficulty{Work.load(std::memory_order_relaxed)};
+
+        // the window runs from the beginning of the oldest bucket until now.
+        uint64 e = epoch(now);
+        uint64 first = e > Buckets ? e - Buckets + 1 : 1;
+        double elapsed = seconds(now) - (first - 1) * Width;
+        if (elapsed <= 0) return x;
+
+        double sum = 0;
+        for (const bucket& b : Window) {
+            uint64 be = b.Epoch.load(std::memory_order_acquire);
+            if (be >= first && be <= e) sum += b.Work.load(std::memory_order_relaxed);
+        }
+
+        x.Hashpower = work::hashpower{sum / elapsed};
+        return x;
+    }
+
+    pool_stats::pool_stats(clock::time_point start, double width) :
+        Pool{start, width}, Width{width}, Mutex{}, Workers{}, JobsMutex{}, Recent{}, Readers{} {}
+
+    pool_stats::~pool_stats() {
+        for (auto& r : Recent) delete r.load();
+    }
+
+    std::shared_ptr<share_stats> pool_stats::worker(const worker_name& name, clock::time_point now) {
+        {
+            std::shared_lock<std::shared_mutex> lock{Mutex};
+            auto w = Workers.find(name);
+            if (w != Workers.end()) return w->second;
+        }
+
+        std::unique_lock<std::shared_mutex> lock{Mutex};
+        auto w = Workers.find(name);
+        if (w != Workers.end()) return w->second;
+        return Workers[name] = std::make_shared<share_stats>(now, Width);
+    }
+
+    void pool_stats::job(job_id id, clock::time_point now) {
+        entry* next = new entry{id, now, Width};
+        std::lock_guard<std::mutex> lock{JobsMutex};
+        entry* last = Recent[id % Jobs].exchange(next);
+        if (last == nullptr) return;
+        Readers.wait();
+        delete last;
+    }
+
+    void pool_stats::record(share_stats& worker, const submission& x, const share_result& r, clock::time_point now) {
+        work::difficulty d{double(x.Difficulty.Value)};
+        Pool.record(r.Status, d, now);
+        worker.record(r.Status, d, now);
+
+        // a stale share may be for a job that has been replaced in the ring.
+        readers::reader reading{Readers};
+        entry* j = Recent[x.Share.JobID % Jobs].load();
+        if (j != nullptr && j->ID == x.Share.JobID) j->Stats.record(r.Status, d, now);
+    }
+
+    pool_stats::snapshot pool_stats::read(clock::time_point now) const {
+        snapshot x;
+        x.Pool = Pool.read(now);
+
+        {
+            std::shared_lock<std::shared_mutex> lock{Mutex};
+            for (const auto& w : Workers) x.Workers[w.first] = w.second->read(now);
+        }
+
+        readers::reader reading{Readers};
+        for (const auto& r : Recent) {
+            entry* j = r.load();
+            if (j != nullptr) x.Jobs[j->ID] = j->Stats.read(now);
+        }
+
+        return x;
+    }
+
+    void to_json(json& j, const share_counts& x) {
+        j = json{
+            {"accepted", x.Accepted},
+            {"rejected", x.Rejected},
+            {"duplicate", x.Duplicate},
+            {"stale", x.Stale},
+            {"work", x.Work.Value},
+            {"hashpower", x.Hashpower.Value}};
+    }
+
+    void to_json(json& j, const pool_stats::snapshot& x) {
+        json workers = json::object();
+        for (const auto& w : x.Workers) to_json(workers[w.first], w.second);
+
+        json jobs = json::object();
+        for (const auto& p : x.Jobs) to_json(jobs[std::to_string(p.first)], p.second);
+
+        json pool;
+        to_json(pool, x.Pool);
+
+        j = json{{"pool", pool}, {"workers", workers}, {"jobs", jobs}};
+    }
+
+}
@@ -87,7 +87,9 @@ namespace Gigamonkey::Stratum {
     
     std::optional<Stratum::error> response::error(const json& j) {
         if (!j.contains("error")) return {};
-        return {error(j["error"])};
+        auto e = j["error"];
+        if (!Stratum::error::valid(e)) return {};
+        return Stratum::error{error_code(uint32(e[0])), string(e[1])};
     }
     
 }
@@ -0,0 +1,71 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/validator.hpp>
+#include <gigamonkey/timechain.hpp>
+#include <atomic>
+#include <thread>
+
+namespace Gigamonkey::Stratum {
+
+    share_validator::share_validator(uint32 threads, uint32 max_shares, size_t max_size, uint32 max_retired) :
+        Jobs{max_size, max_retired, max_shares}, Threads{threads} {}
+
+    bool share_validator::notify(const mining::notify::parameters& n) {
+        return Jobs.notify(n);
+    }
+
+    bool share_validator::remove(job_id id) {
+        return Jobs.remove(id);
+    }
+
+    size_t share_validator::jobs() const {
+        return Jobs.jobs();
+    }
+
+    share_result share_validator::validate(const submission& x) {
+        auto found = Jobs.find(x.Share.JobID);
+        if (found.Status == job_registry::stale) return {share_stale, work::difficulty{}, false};
+        if (found.Status != job_registry::found) return {};
+
+        const job_registry::entry& j = *found.Job;
+        const work::candidate& c = j.Puzzle.Candidate;
+        const work::share& s = x.Share.Share;
+
+        byte header[80];
+        Bitcoin::header::write(header, c.Category, c.Digest,
+            j.merkle_root(x.ExtraNonce1, s.ExtraNonce2).Value, s.Timestamp, c.Target, s.Nonce);
+
+        uint256 hash = Bitcoin::hash256(bytes_view{header, 80}).Value;
+
+        // the difficulty is only reported. Whether the share is good is
+        // decided by comparing the hash with the targets exactly.
+        work::difficulty achieved = work::difficulty::of(hash);
+        bool solved = work::below(hash, c.Target);
+
+        if (!solved && !work::below(hash, x.Target)) return {share_rejected, achieved, false};
+
+        switch (j.Shares.insert(x.ExtraNonce1, s)) {
+            case share_set::inserted: return {share_accepted, achieved, solved};
+            case share_set::duplicate: return {share_duplicate, achieved, solved};
+            default: return {share_rejected, achieved, solved};
+        }
+    }
+
+    void share_validator::validate(const submission* x, share_result* results, size_t count) {
+        // threads take batches of shares as they become free.
+        constexpr size_t batch = 64;
+        size_t batches = (count + batch - 1) / batch;
+        std::atomic<size_t> next{0};
+        auto work = [this, x, results, count, batches, &next]() {
+            for (size_t k = next++; k < batches; k = next++)
+                for (size_t i = k * batch; i < std::min(count, (k + 1) * batch); i++) results[i] = validate(x[i]);
+        };
+
+        std::vector<std::thread> pool;
+        for (uint32 i = 1; i < std::min(size_t(Threads), batches); i++) pool.emplace_back(work);
+        work();
+        for (std::thread& t : pool) t.join();
+    }
+
+}
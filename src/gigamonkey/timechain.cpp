@@ -3,6 +3,8 @@
 
 #include <gigamonkey/work/proof.hpp>
 #include <gigamonkey/script/script.hpp>
+#include <atomic>
+#include <thread>
 
 namespace Gigamonkey {
     bool header_valid_work(slice<80> h) {
@@ -51,6 +53,102 @@ namespace Gigamonkey::Bitcoin {
         return 9;
     }
     
+    namespace {
+        
+        // read a var int at i. Returns nullptr if it does not fit before end. 
+        const byte* read_var_int(const byte* i, const byte* end, uint64& x) {
+            if (i == end) return nullptr;
+            byte b = *i++;
+            size_t size = b <= 0xfc ? 0 : b == 0xfd ? 2 : b == 0xfe ? 4 : 8;
+            if (end - i < static_cast<ptrdiff_t>(size)) return nullptr;
+            
+            if (size == 0) x = b;
+            else if (size == 2) x = boost::endian::load_little_u16(i);
+            else if (size == 4) x = boost::endian::load_little_u32(i);
+            else x = boost::endian::load_little_u64(i);
+            
+            return i + size;
+        }
+        
+        // skip over a script and the given number of bytes after it. 
+        const byte* skip_script(const byte* i, const byte* end, size_t after) {
+            uint64 size;
+            i = read_var_int(i, end, size);
+            if (i == nullptr || size > uint64(end - i) || uint64(end - i) - size < after) return nullptr;
+            return i + size + after;
+        }
+        
+        const byte* skip_input(const byte* i, const byte* end) {
+            if (end - i < 36) return nullptr;
+            return skip_script(i + 36, end, 4);
+        }
+        
+        const byte* skip_output(const byte* i, const byte* end) {
+            if (end - i < 8) return nullptr;
+            return skip_script(i + 8, end, 0);
+        }
+        
+        // find the end of the transaction beginning at i, or nullptr if it does not fit. 
+        // Only var ints are read; scripts are skipped over. each(b, false) is called 
+        // with the beginning of each input and then with the end of the inputs, and 
+        // each(b, true) is called the same way for the outputs. 
+        template <typename f> 
+        const byte* scan_transaction(const byte* i, const byte* end, f each) {
+            if (end - i < 4) return nullptr;
+            i += 4;
+            
+            uint64 count;
+            i = read_var_int(i, end, count);
+            if (i == nullptr) return nullptr;
+            for (uint64 n = 0; n < count; n++) {
+                each(i, false);
+                i = skip_input(i, end);
+                if (i == nullptr) return nullptr;
+            }
+            each(i, false);
+            
+            i = read_var_int(i, end, count);
+            if (i == nullptr) return nullptr;
+            for (uint64 n = 0; n < count; n++) {
+                each(i, true);
+                i = skip_output(i, end);
+                if (i == nullptr) return nullptr;
+            }
+            each(i, true);
+            
+            if (end - i < 4) return nullptr;
+            return i + 4;
+        }
+        
+        // the given input or output, or nothing if it is not there. 
+        bytes_view element(bytes_view b, uint32 index, bool output) {
+            const byte* i = b.data();
+            const byte* end = i + b.size();
+            if (end - i < 4) return {};
+            i += 4;
+            
+            uint64 count;
+            i = read_var_int(i, end, count);
+            if (i == nullptr) return {};
+            
+            if (output) {
+                for (uint64 n = 0; n < count && i != nullptr; n++) i = skip_input(i, end);
+                if (i == nullptr) return {};
+                i = read_var_int(i, end, count);
+                if (i == nullptr) return {};
+            }
+            
+            auto skip = output ? skip_output : skip_input;
+            if (index >= count) return {};
+            for (uint32 n = 0; n < index && i != nullptr; n++) i = skip(i, end);
+            if (i == nullptr) return {};
+            
+            const byte* next = skip(i, end);
+            if (next == nullptr) return {};
+            return bytes_view{i, static_cast<size_t>(next - i)};
+        }
+    }
+    
     int32_little header::version(const slice<80> x) {
         int32_little version;
         slice<4> v = x.range<0, 4>();
@@ -159,23 +257,208 @@ namespace Gigamonkey::Bitcoin {
     }
     
     std::vector<bytes_view> block::transactions(bytes_view b) {
-        bytes_reader r(b.data(), b.data() + b.size());
-        Bitcoin::header h;
-        r = (reader{r} >> h).Reader;
-        uint64 num_txs;
-        r = reader::read_var_int(r, num_txs);
+        if (b.size() < 80) return {};
+        const byte* i = b.data() + 80;
+        const byte* end = b.data() + b.size();
+        
+        uint64 count;
+        i = read_var_int(i, end, count);
+        if (i == nullptr) return {};
+        
+        // a transaction is at least ten bytes, so don't believe a count that cannot fit. 
         std::vector<bytes_view> x;
-        x.resize(num_txs);
-        auto prev = r.Reader.Begin;
-        for (int i = 0; i < num_txs; i++) {
-            transaction tx;
-            r = (reader{r} >> tx).Reader;
-            auto next = r.Reader.Begin;
-            x[i] = bytes_view{prev, static_cast<size_t>(next - prev)};
-            prev = next;
+        x.reserve(std::min(count, uint64(end - i) / 10));
+        for (uint64 n = 0; n < count; n++) {
+            const byte* next = scan_transaction(i, end, [](const byte*, bool) {});
+            if (next == nullptr) return {};
+            x.push_back(bytes_view{i, static_cast<size_t>(next - i)});
+            i = next;
         }
+        
+        return x;
+    }
+    
+    digest256 block::merkle_root(bytes_view b, uint32 threads) {
+        std::vector<bytes_view> txs = transactions(b);
+        if (txs.size() == 0) return {};
+        
+        std::vector<txid> ids(txs.size());
+        
+        // threads take batches of transactions as they become free. 
+        constexpr uint32 batch = 1024;
+        uint32 batches = (txs.size() + batch - 1) / batch;
+        std::atomic<uint32> next{0};
+        auto work = [&txs, &ids, &next, batches]() {
+            for (uint32 k = next++; k < batches; k = next++) {
+                size_t begin = size_t(k) * batch;
+                Bitcoin::hash256_many(txs.data() + begin, ids.data() + begin, std::min(size_t(batch), txs.size() - begin));
+            }
+        };
+        
+        std::vector<std::thread> pool;
+        for (uint32 i = 1; i < std::min(threads, batches); i++) pool.emplace_back(work);
+        work();
+        for (std::thread& t : pool) t.join();
+        
+        // ids is ours to overwrite, so one thread builds the root in place. 
+        if (threads <= 1) return Merkle::root(ids.data(), ids.size());
+        return Merkle::root(ids.data(), ids.size(), threads);
+    }
+    
+    // any 36 bytes can be read as an outpoint. 
+    bool outpoint::valid(slice<36>) {
+        return true;
+    }
+    
+    txid outpoint::reference(slice<36> x) {
+        return txid{x.range<0, 32>()};
+    }
+    
+    index outpoint::index(slice<36> x) {
+        Gigamonkey::index n;
+        slice<4> v = x.range<32, 36>();
+        std::copy(v.begin(), v.end(), n.data());
+        return n;
+    }
+    
+    bool input::valid(bytes_view b) {
+        return b.size() > 0 && skip_input(b.data(), b.data() + b.size()) == b.data() + b.size();
+    }
+    
+    slice<36> input::previous(bytes_view b) {
+        static byte Empty[36]{};
+        if (b.size() < 36) return slice<36>(Empty);
+        return slice<36>(const_cast<byte*>(b.data()));
+    }
+    
+    bytes_view input::script(bytes_view b) {
+        if (!valid(b)) return {};
+        const byte* end = b.data() + b.size() - 4;
+        uint64 size;
+        const byte* i = read_var_int(b.data() + 36, end, size);
+        return bytes_view{i, static_cast<size_t>(size)};
+    }
+    
+    uint32_little input::sequence(bytes_view b) {
+        if (b.size() < 4) return {};
+        return uint32_little{boost::endian::load_little_u32(b.data() + b.size() - 4)};
+    }
+    
+    bool output::valid(bytes_view b) {
+        return b.size() > 0 && skip_output(b.data(), b.data() + b.size()) == b.data() + b.size();
+    }
+    
+    satoshi output::value(bytes_view b) {
+        if (b.size() < 8) return {};
+        return satoshi{static_cast<int64>(boost::endian::load_little_u64(b.data()))};
+    }
+    
+    bytes_view output::script(bytes_view b) {
+        if (!valid(b)) return {};
+        const byte* end = b.data() + b.size();
+        uint64 size;
+        const byte* i = read_var_int(b.data() + 8, end, size);
+        return bytes_view{i, static_cast<size_t>(size)};
+    }
+    
+    bool transaction::valid(bytes_view b) {
+        transaction_view t{b};
+        return t.valid();
+    }
+    
+    int32_little transaction::version(bytes_view b) {
+        if (b.size() < 4) return {};
+        return int32_little{static_cast<int32>(boost::endian::load_little_u32(b.data()))};
+    }
+    
+    int32_little transaction::locktime(bytes_view b) {
+        if (b.size() < 4) return {};
+        return int32_little{static_cast<int32>(boost::endian::load_little_u32(b.data() + b.size() - 4))};
+    }
+    
+    bytes_view transaction::input(bytes_view b, Gigamonkey::index i) {
+        return element(b, i, false);
+    }
+    
+    bytes_view transaction::output(bytes_view b, Gigamonkey::index i) {
+        return element(b, i, true);
+    }
+    
+    cross<bytes_view> transaction::inputs(bytes_view b) {
+        transaction_view t{b};
+        cross<bytes_view> x;
+        x.resize(t.inputs().size());
+        uint32 n = 0;
+        for (const transaction_view::input& i : t.inputs()) x[n++] = i.Data;
         return x;
     }
     
+    cross<bytes_view> transaction::outputs(bytes_view b) {
+        transaction_view t{b};
+        cross<bytes_view> x;
+        x.resize(t.outputs().size());
+        uint32 n = 0;
+        for (const transaction_view::output& o : t.outputs()) x[n++] = o.Data;
+        return x;
+    }
+    
+    txid transaction::id(bytes_view b) {
+        return hash256(b);
+    }
+    
+    void transaction_view::index() const {
+        if (Indexed) return;
+        Indexed = true;
+        
+        const byte* begin = Data.data();
+        const byte* end = begin + Data.size();
+        
+        uint32 inputs = 0;
+        Valid = scan_transaction(begin, end, [this, begin, &inputs](const byte* i, bool output) {
+            Offsets.push_back(static_cast<uint32>(i - begin));
+            if (!output) inputs++;
+        }) == end;
+        
+        if (Valid) Inputs = inputs - 1;
+        else Offsets.clear();
+    }
+    
+    bool transaction_view::valid() const {
+        return inputs().size() > 0 && outputs().size() > 0;
+    }
+    
+    transaction_view::elements<transaction_view::input> transaction_view::inputs() const {
+        index();
+        if (!Valid) return {Data.data(), nullptr, 0};
+        return {Data.data(), Offsets.data(), Inputs};
+    }
+    
+    transaction_view::elements<transaction_view::output> transaction_view::outputs() const {
+        index();
+        if (!Valid) return {Data.data(), nullptr, 0};
+        return {Data.data(), Offsets.data() + Inputs + 1, static_cast<uint32>(Offsets.size() - Inputs - 2)};
+    }
+    
+    outpoint transaction_view::input::previous() const {
+        slice<36> x = Bitcoin::input::previous(Data);
+        return outpoint{outpoint::reference(x), outpoint::index(x)};
+    }
+    
+    bytes_view transaction_view::input::script() const {
+        return Bitcoin::input::script(Data);
+    }
+    
+    uint32_little transaction_view::input::sequence() const {
+        return Bitcoin::input::sequence(Data);
+    }
+    
+    satoshi transaction_view::output::value() const {
+        return Bitcoin::output::value(Data);
+    }
+    
+    bytes_view transaction_view::output::script() const {
+        return Bitcoin::output::script(Data);
+    }
+    
 }
 
@@ -2,7 +2,13 @@
 // Distributed under the Open BSV software license, see the accompanying file LICENSE.
 
 #include <gigamonkey/work/proof.hpp>
+#include <gigamonkey/work/solver.hpp>
 #include <gigamonkey/hash.hpp>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include "arith_uint256.h"
 
@@ -14,33 +20,190 @@ namespace Gigamonkey::work {
         // This is for test purposes only. Therefore we do not
         // accept difficulties that are above the ordinary minimum. 
         if (p.Candidate.Target.difficulty() > difficulty::minimum()) return {}; 
-        proof pr{p, initial};
-        while(!pr.valid()) pr.Solution.Share.Nonce++;
-        return pr;
+        return solver{}.solve(p, initial);
     }
     
-    // copied from arith_uint256.cpp and therefore probably works. 
-    uint256 expand(const compact& c) {
-        uint32 compact = c;
-        uint256 expanded;
-        int nSize = compact >> 24;
-        uint32_t nWord = compact & 0x007fffff;
-        if (nSize <= 3) {
-            nWord >>= 8 * (3 - nSize);
-            expanded = nWord;
-        } else {
-            expanded = nWord;
-            expanded <<= 8 * (nSize - 3);
+    bool midstate::search(uint32 first, uint32 count, const uint256& target) {
+        // the most significant word of the target. 
+        uint32 top = boost::endian::load_little_u32(target.data() + 28);
+        
+        uint32 candidates[16];
+        uint32 found;
+        while (count > 0) {
+            uint32 scanned = Bitcoin::hash256_80_scan(State.data(), Tail.data(), first, count, top, candidates, found);
+            for (uint32 i = 0; i < found; i++) {
+                set(Gigamonkey::nonce{candidates[i]});
+                if (hash().Value < target) return true;
+            }
+            
+            first += scanned;
+            count -= scanned;
+        }
+        
+        return false;
+    }
+    
+    proof solver::solve(const puzzle& p, const solution& initial, const cancellation& c) const {
+        uint256 target = p.Candidate.Target.expand();
+        if (target == 0) return {};
+        
+        const uint32 threads = std::max(Threads, uint32(1));
+        const uint64 slice = (uint64(1) << 32) / threads;
+        
+        // how many hashes are done between checking whether to stop. 
+        constexpr uint64 interval = 1 << 16;
+        
+        // slices are numbered in order across all extra nonces. 
+        std::atomic<uint64> next{0};
+        std::atomic<uint64> hashes{0};
+        std::atomic<bool> done{false};
+        
+        std::mutex mutex;
+        std::condition_variable finished;
+        uint32 running = threads;
+        proof result{};
+        
+        auto work = [&]() {
+            solution x = initial;
+            uint64 current = 0;
+            midstate header{proof{p, x}.string()};
+            
+            while (!done && !c.cancelled()) {
+                uint64 n = next++;
+                uint64 round = n / threads;
+                uint64 part = n % threads;
+                
+                if (round != current) {
+                    current = round;
+                    x.Share.ExtraNonce2 = uint64_big{uint64(initial.Share.ExtraNonce2) + round};
+                    if (UpdateTimestamp) x.Share.Timestamp = std::max(initial.Share.Timestamp, Bitcoin::timestamp::now());
+                    header = midstate{proof{p, x}.string()};
+                }
+                
+                uint32 begin = uint32(initial.Share.Nonce) + static_cast<uint32>(part * slice);
+                uint64 count = part + 1 == threads ? (uint64(1) << 32) - part * slice : slice;
+                
+                uint64 i = 0;
+                while (i < count) {
+                    uint32 size = static_cast<uint32>(std::min(count - i, interval));
+                    bool found = header.search(begin + static_cast<uint32>(i), size, target);
+                    
+                    // only the nonces up to the solution were tried. 
+                    hashes += found ? uint32(header.nonce()) - (begin + static_cast<uint32>(i)) + 1 : size;
+                    i += size;
+                    
+                    if (found) {
+                        std::lock_guard<std::mutex> lock{mutex};
+                        if (!done) {
+                            x.Share.Nonce = header.nonce();
+                            result = proof{p, x};
+                            done = true;
+                        }
+                        break;
+                    }
+                    
+                    if (done || c.cancelled()) break;
+                }
+            }
+            
+            std::lock_guard<std::mutex> lock{mutex};
+            running--;
+            finished.notify_all();
+        };
+        
+        std::vector<std::thread> pool;
+        for (uint32 i = 0; i < threads; i++) pool.emplace_back(work);
+        
+        // wait here and report the hashrate now and then. 
+        // Without a positive interval there are no reports. 
+        const bool reporting = ReportInterval > 0;
+        auto start = std::chrono::steady_clock::now();
+        auto report = start;
+        if (reporting) report += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(ReportInterval));
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            while (running > 0) {
+                if (!reporting) {
+                    finished.wait(lock);
+                    continue;
+                }
+                
+                finished.wait_until(lock, report);
+                auto now = std::chrono::steady_clock::now();
+                if (running > 0 && now >= report) {
+                    report = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(ReportInterval));
+                    if (Report) Report(hashes / std::chrono::duration<double>(now - start).count());
+                }
+            }
         }
         
-        // negative 
-        if (nWord != 0 && (compact & 0x00800000) != 0) return 0;
+        for (std::thread& t : pool) t.join();
         
-        // overflow
-        if (nWord != 0 && ((nSize > 34) || (nWord > 0xff && nSize > 33) ||
-                           (nWord > 0xffff && nSize > 32))) return 0;
+        return result;
+    }
+    
+    uint32 leading(const uint256& x, uint64& mantissa) {
+        for (int i = 3; i >= 0; i--) {
+            uint64 limb = boost::endian::load_little_u64(x.data() + 8 * i);
+            if (limb == 0) continue;
+            int zeros = __builtin_clzll(limb);
+            mantissa = limb << zeros;
+            if (zeros > 0 && i > 0) mantissa |= boost::endian::load_little_u64(x.data() + 8 * (i - 1)) >> (64 - zeros);
+            return 64 * i + 64 - zeros;
+        }
         
-        return expanded;
+        mantissa = 0;
+        return 0;
+    }
+    
+    // unit() is 0xffff * 2^208. 
+    difficulty difficulty::of(const uint256& x) {
+        uint64 mantissa;
+        uint32 bits = leading(x, mantissa);
+        if (bits == 0) return of(uint256{1});
+        return difficulty{std::ldexp(65535.0 / double(mantissa), 272 - int(bits))};
+    }
+    
+    // the expanded target is digits * 256^(exponent - 3), so no 256 bit number is needed. 
+    difficulty compact::difficulty() const {
+        uint32 c = static_cast<uint32_little>(*this);
+        int e = exponent();
+        uint32 word = c & 0x007fffff;
+        
+        // digits are shifted off the end. 
+        if (e <= 3) return work::difficulty::of(expand());
+        
+        if (word == 0 || (c & 0x00800000) != 0 || 
+            e > 34 || (word > 0xff && e > 33) || (word > 0xffff && e > 32)) return work::difficulty{};
+        
+        return work::difficulty{std::ldexp(65535.0 / double(word), 232 - 8 * e)};
+    }
+    
+    compact::compact(work::difficulty d) : compact{} {
+        if (!(d.Value > 0)) return;
+        
+        // the target is f * 2^size. 
+        int size;
+        double f = std::frexp(65535.0 / d.Value, &size);
+        size += 208;
+        if (size <= 0 || size > 256) return;
+        
+        // the nearest compact, so that converting back and forth does not drift. 
+        int bytes = (size + 7) / 8;
+        uint32 digits = static_cast<uint32>(std::round(std::ldexp(f, size - 8 * (bytes - 3))));
+        
+        // the top bit of the digits is a sign, so the digits are 
+        // rounded again one byte further down. 
+        if (digits & 0xff800000) {
+            bytes++;
+            digits = static_cast<uint32>(std::round(std::ldexp(f, size - 8 * (bytes - 3))));
+        }
+        
+        *this = compact{static_cast<uint32>(bytes << 24) | digits};
+    }
+    
+    uint256 expand(const compact& c) {
+        return from_words(expand_words(uint32(c)));
     }
     
 }
@@ -0,0 +1,29 @@
+// Copyright (c) 2019 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/difficulty.hpp>
+#include "targets.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <iostream>
+
+namespace Gigamonkey::Stratum {
+    TEST(DifficultyBenchmark, TargetToDiff) {
+        std::vector<uint256> targets = random_targets(100000);
+        
+        uint64 fast = 0;
+        uint64 slow = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const uint256& t : targets) fast += difficulty(t).Value;
+        auto middle = std::chrono::steady_clock::now();
+        for (const uint256& t : targets) slow += slow_target_to_difficulty(t);
+        auto end = std::chrono::steady_clock::now();
+        
+        EXPECT_EQ(fast, slow);
+        
+        std::cout << "target to difficulty: " << 
+            (targets.size() / std::chrono::duration<double>(middle - start).count() / 1e6) << " M/s, " << 
+            (targets.size() / std::chrono::duration<double>(end - middle).count() / 1e6) << " M/s with base_uint division." << std::endl;
+    }
+    
+}
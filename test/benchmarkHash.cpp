@@ -0,0 +1,43 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/hash.hpp>
+#include "messages.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <iostream>
+
+namespace Gigamonkey::Bitcoin {
+
+    TEST(HashBenchmark, Hash256Many) {
+
+        // Merkle nodes are 64 bytes and headers are 80 bytes.
+        for (size_t size : {64, 80}) {
+            const size_t count = 1 << 18;
+
+            bytes data = test_message(size * count, 0);
+            std::vector<bytes_view> views(count);
+            for (size_t i = 0; i < count; i++) views[i] = bytes_view{data.data() + size * i, size};
+
+            std::vector<digest256> many(count);
+            std::vector<digest256> one(count);
+
+            auto start = std::chrono::steady_clock::now();
+            hash256_many(views.data(), many.data(), count);
+            auto middle = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < count; i++) one[i] = hash256(views[i]);
+            auto end = std::chrono::steady_clock::now();
+
+            EXPECT_EQ(many, one);
+
+            double batched = std::chrono::duration<double>(middle - start).count();
+            double single = std::chrono::duration<double>(end - middle).count();
+
+            std::cout << "hash256 of " << count << " messages of " << size << " bytes: " <<
+                (count / batched / 1e6) << " M/s with " << hash256_engine() << ", " <<
+                (count / single / 1e6) << " M/s one at a time." << std::endl;
+        }
+
+    }
+
+}
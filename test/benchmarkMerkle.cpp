@@ -0,0 +1,74 @@
+// Copyright (c) 2019 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/merkle.hpp>
+#include "list_root.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <iostream>
+
+namespace Gigamonkey::Merkle {
+    
+    TEST(MerkleBenchmark, FlatRoot) {
+        const uint32 width = 1 << 20;
+        
+        leaf_digests l{};
+        std::vector<digest> leaves(width);
+        for (uint32 i = 0; i < width; i++) {
+            leaves[i] = Bitcoin::hash256(std::to_string(i));
+            l = l << leaves[i];
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        digest flat = root(leaves);
+        auto middle = std::chrono::steady_clock::now();
+        digest listed = list_root(l);
+        auto end = std::chrono::steady_clock::now();
+        
+        EXPECT_EQ(flat, listed);
+        
+        std::cout << "Merkle root of " << width << " leaves: " << 
+            std::chrono::duration<double>(middle - start).count() << " s flat, " << 
+            std::chrono::duration<double>(end - middle).count() << " s as a list." << std::endl;
+    }
+    
+    TEST(MerkleBenchmark, ParallelServer) {
+        const uint32 width = 1 << 21;
+        
+        std::vector<digest> leaves(width);
+        for (uint32 i = 0; i < width; i++) leaves[i] = Bitcoin::hash256(std::to_string(i));
+        
+        server expected{leaves};
+        
+        for (uint32 threads : {1, 2, 4, 8, 16}) {
+            auto start = std::chrono::steady_clock::now();
+            server x{leaves, threads};
+            auto end = std::chrono::steady_clock::now();
+            
+            EXPECT_EQ(x, expected);
+            
+            std::cout << "Merkle server of " << width << " leaves on " << threads << " threads: " << 
+                std::chrono::duration<double>(end - start).count() << " s." << std::endl;
+        }
+    }
+    
+    TEST(MerkleBenchmark, CoinbaseCache) {
+        const uint32 width = 100000;
+        
+        std::vector<digest> transactions(width - 1);
+        for (uint32 i = 0; i < width - 1; i++) transactions[i] = Bitcoin::hash256(std::to_string(i));
+        
+        coinbase_cache Cache{transactions};
+        
+        const uint32 refreshes = 1000;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32 i = 0; i < refreshes; i++) {
+            Cache << Bitcoin::hash256(std::to_string(width + i));
+            Cache.path();
+        }
+        auto end = std::chrono::steady_clock::now();
+        
+        std::cout << "coinbase path refreshed after appending to " << width << " transactions in " << 
+            (std::chrono::duration<double, std::micro>(end - start).count() / refreshes) << " microseconds." << std::endl;
+    }
+}
@@ -0,0 +1,27 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/timechain.hpp>
+#include "blocks.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <iostream>
+
+namespace Gigamonkey::Bitcoin {
+    
+    TEST(TransactionBenchmark, BlockMerkleRoot) {
+        // about 64 MB. 
+        bytes b = test_block(1 << 18);
+        
+        for (uint32 threads : {1, 4, 16}) {
+            auto start = std::chrono::steady_clock::now();
+            digest256 root = block::merkle_root(b, threads);
+            auto end = std::chrono::steady_clock::now();
+            
+            EXPECT_TRUE(root.valid());
+            std::cout << "Merkle root of a " << (b.size() >> 20) << " MB block on " << threads << " threads: " << 
+                std::chrono::duration<double>(end - start).count() << " seconds." << std::endl;
+        }
+    }
+    
+}
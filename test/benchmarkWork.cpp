@@ -0,0 +1,63 @@
+// Copyright (c) 2019 Katrina Swales
+// Copyright (c) 2019 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/work/proof.hpp>
+#include "gtest/gtest.h"
+#include <chrono>
+#include <iostream>
+
+namespace Gigamonkey::work {
+    
+    TEST(WorkBenchmark, Midstate) {
+        string x{2, sha256(std::string{"previous"}), sha256(std::string{"root"}), Bitcoin::timestamp(1234567), compact{32, 0x080000}, 0};
+        midstate m{x};
+        
+        const uint32 count = 1 << 20;
+        uint32 valid = 0;
+        
+        auto start = std::chrono::steady_clock::now();
+        for (uint32 n = 0; n < count; n++) {
+            m.set(nonce{n});
+            if (m.hash().Value == 0) valid++;
+        }
+        auto middle = std::chrono::steady_clock::now();
+        uint<80> header = x.write();
+        for (uint32 n = 0; n < count; n++) {
+            boost::endian::store_little_u32(header.data() + 76, n);
+            if (Bitcoin::hash256(bytes_view(header)).Value == 0) valid++;
+        }
+        auto end = std::chrono::steady_clock::now();
+        
+        EXPECT_EQ(valid, 0);
+        std::cout << "header hashes per second: " << 
+            (count / std::chrono::duration<double>(middle - start).count() / 1e6) << " M with midstate, " << 
+            (count / std::chrono::duration<double>(end - middle).count() / 1e6) << " M without." << std::endl;
+    }
+    
+    TEST(WorkBenchmark, NonceScan) {
+        string x{2, sha256(std::string{"previous"}), sha256(std::string{"root"}), Bitcoin::timestamp(1234567), compact{32, 0x080000}, 0};
+        midstate m{x};
+        
+        // a target that nothing will meet, so that every nonce is tried. 
+        const uint32 count = 1 << 22;
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_FALSE(m.search(0, count, uint256{0}));
+        auto middle = std::chrono::steady_clock::now();
+        
+        // the way cpu_solve used to go through nonces. 
+        const uint32 old_count = 1 << 16;
+        proof pr{puzzle{2, sha256(std::string{"previous"}), compact{20, 0x010000}, Merkle::path{}, bytes{}, bytes{}}, 
+            solution{Bitcoin::timestamp(1), 0, 1, 353}};
+        for (uint32 n = 0; n < old_count; n++) {
+            EXPECT_FALSE(pr.valid());
+            pr.Solution.Share.Nonce++;
+        }
+        auto end = std::chrono::steady_clock::now();
+        
+        std::cout << "nonces per second: " << 
+            (count / std::chrono::duration<double>(middle - start).count() / 1e6) << " M with " << Bitcoin::hash256_80_scan_engine() << ", " << 
+            (old_count / std::chrono::duration<double>(end - middle).count() / 1e6) << " M rebuilding the proof as cpu_solve did." << std::endl;
+    }
+    
+}
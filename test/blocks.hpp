@@ -0,0 +1,98 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_TEST_BLOCKS
+#define GIGAMONKEY_TEST_BLOCKS
+
+#include <gigamonkey/timechain.hpp>
+#include <vector>
+
+namespace Gigamonkey::Bitcoin {
+
+    // the genesis coinbase.
+    inline bytes genesis_coinbase_tx() {
+        return bytes(encoding::hex::string{std::string{} +
+            "01000000010000000000000000000000000000000000000000000000000000000000000000" +
+            "FFFFFFFF4D04FFFF001D0104455468652054696D65732030332F4A616E2F32303039204368" +
+            "616E63656C6C6F72206F6E206272696E6B206F66207365636F6E64206261696C6F75742066" +
+            "6F722062616E6B73FFFFFFFF0100F2052A01000000434104678AFDB0FE5548271967F1A671" +
+            "30B7105CD6A828E03909A67962E0EA1F61DEB649F6BC3F4CEF38C4F35504E51EC112DE5C38" +
+            "4DF7BA0B8D578A4C702B6BF11D5FAC00000000"});
+    }
+
+    // a block of copies of the genesis coinbase, each with a different locktime.
+    inline bytes test_block(uint32 count) {
+        bytes tx = genesis_coinbase_tx();
+
+        // the number of transactions is always written in five bytes.
+        bytes b(85 + count * tx.size());
+        b[80] = 0xfe;
+        boost::endian::store_little_u32(b.data() + 81, count);
+
+        for (uint32 i = 0; i < count; i++) {
+            byte* x = b.data() + 85 + i * tx.size();
+            std::copy(tx.begin(), tx.end(), x);
+            boost::endian::store_little_u32(x + tx.size() - 4, i);
+        }
+
+        return b;
+    }
+
+    // append x in the given number of bytes, little endian.
+    inline void append_little(bytes& b, uint64 x, uint32 size) {
+        for (uint32 i = 0; i < size; i++) b.push_back(byte(x >> (8 * i)));
+    }
+
+    inline void append_var_int(bytes& b, uint64 x) {
+        if (x <= 0xfc) return append_little(b, x, 1);
+        if (x <= 0xffff) {
+            b.push_back(0xfd);
+            return append_little(b, x, 2);
+        }
+
+        if (x <= 0xffffffff) {
+            b.push_back(0xfe);
+            return append_little(b, x, 4);
+        }
+
+        b.push_back(0xff);
+        append_little(b, x, 8);
+    }
+
+    // a transaction with every script the given size. The scripts are not
+    // real scripts, but nothing that reads transactions in place looks at them.
+    inline bytes test_transaction(uint32 inputs, uint32 outputs, uint32 script_size, uint32 locktime) {
+        bytes tx;
+        append_little(tx, 1, 4);
+
+        append_var_int(tx, inputs);
+        for (uint32 i = 0; i < inputs; i++) {
+            for (uint32 j = 0; j < 32; j++) tx.push_back(byte(locktime + i + j));
+            append_little(tx, i, 4);
+            append_var_int(tx, script_size);
+            tx.insert(tx.end(), script_size, byte(i));
+            append_little(tx, 0xffffffff, 4);
+        }
+
+        append_var_int(tx, outputs);
+        for (uint32 i = 0; i < outputs; i++) {
+            append_little(tx, 1000 + i, 8);
+            append_var_int(tx, script_size);
+            tx.insert(tx.end(), script_size, byte(i));
+        }
+
+        append_little(tx, locktime, 4);
+        return tx;
+    }
+
+    // a block of the given transactions.
+    inline bytes test_block(const std::vector<bytes>& txs) {
+        bytes b(80);
+        append_var_int(b, txs.size());
+        for (const bytes& tx : txs) b.insert(b.end(), tx.begin(), tx.end());
+        return b;
+    }
+
+}
+
+#endif
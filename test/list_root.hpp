@@ -0,0 +1,28 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_TEST_LIST_ROOT
+#define GIGAMONKEY_TEST_LIST_ROOT
+
+#include <gigamonkey/merkle.hpp>
+
+namespace Gigamonkey::Merkle {
+
+    // the way roots were calculated before, one level at a time as a list.
+    inline digest list_root(leaf_digests l) {
+        if (l.size() == 0) return {};
+        while (l.size() > 1) {
+            leaf_digests r{};
+            while (l.size() >= 2) {
+                r = r << hash_concatinated(l.first(), l.rest().first());
+                l = l.rest().rest();
+            }
+            if (l.size() == 1) r = r << hash_concatinated(l.first(), l.first());
+            l = r;
+        }
+        return l.first();
+    }
+
+}
+
+#endif
@@ -0,0 +1,20 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_TEST_MESSAGES
+#define GIGAMONKEY_TEST_MESSAGES
+
+#include <gigamonkey/types.hpp>
+
+namespace Gigamonkey::Bitcoin {
+
+    // bytes to hash that are different for every size and seed.
+    inline bytes test_message(size_t size, uint32 seed) {
+        bytes b(size);
+        for (size_t i = 0; i < size; i++) b[i] = static_cast<byte>((i * 31 + seed * 17) ^ (i >> 3));
+        return b;
+    }
+
+}
+
+#endif
@@ -0,0 +1,34 @@
+// Copyright (c) 2019 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_TEST_TARGETS
+#define GIGAMONKEY_TEST_TARGETS
+
+#include <gigamonkey/stratum/difficulty.hpp>
+#include <random>
+#include <vector>
+
+namespace Gigamonkey::Stratum {
+
+    // the old way, using 256 bit division.
+    inline uint64 slow_target_to_difficulty(const uint256& target) {
+        return (work::compact{0x1d00ffff}.expand() / target).GetLow64();
+    }
+
+    // the same targets every time, of many sizes.
+    inline std::vector<uint256> random_targets(size_t count) {
+        std::mt19937_64 random{7};
+        std::vector<uint256> targets;
+        while (targets.size() < count) {
+            uint256 t{0};
+            int bits = 33 + random() % 200;
+            for (int i = 0; i < 4; i++) boost::endian::store_little_u64(t.data() + 8 * i, random());
+            t >>= (256 - bits);
+            if (t != 0) targets.push_back(t);
+        }
+        return targets;
+    }
+
+}
+
+#endif
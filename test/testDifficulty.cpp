@@ -3,7 +3,9 @@
 
 #include <gigamonkey/work/target.hpp>
 #include <gigamonkey/stratum/difficulty.hpp>
+#include "targets.hpp"
 #include "gtest/gtest.h"
+#include <cmath>
 
 namespace Gigamonkey::work {
 
@@ -55,12 +57,41 @@ namespace Gigamonkey::work {
         EXPECT_GT(difficulty(2), difficulty(3) / difficulty(2));*/
         
     }
+    
+    TEST(DifficultyTest, TestCompactDifficulty) {
+        for (const compact& c : {SuccessHalf, SuccessQuarter, SuccessEighth, SuccessSixteenth, 
+            compact{0x1d00ffff}, compact{0x1b0404cb}, compact{0x180d9bd0}}) {
+            double expected = difficulty::unit().getdouble() / c.expand().getdouble();
+            EXPECT_NEAR(double(c.difficulty()), expected, expected * 1e-15);
+            EXPECT_NEAR(double(difficulty::of(c.expand())), expected, expected * 1e-15);
+            EXPECT_EQ(compact{c.difficulty()}, c);
+        }
+        
+        EXPECT_EQ(compact{difficulty{1}}, compact{0x1d00ffff});
+        
+        // targets with the top bit of their first three bytes set are rounded to two bytes. 
+        double unit = difficulty::unit().getdouble();
+        EXPECT_EQ(compact{difficulty{unit / (double(0x80ffc0) * std::ldexp(1., 200))}}, compact{0x1d008100});
+        EXPECT_EQ(compact{difficulty{unit / (double(0xffffff) * std::ldexp(1., 200))}}, compact{0x1d010000});
+        
+        EXPECT_FALSE(compact{difficulty{0}}.valid());
+        EXPECT_EQ(difficulty::of(uint256{0}), difficulty::of(uint256{1}));
+        EXPECT_GT(difficulty::of(uint256{1}), difficulty::of(uint256{2}));
+    }
 
 }
 
 //taken from btc pool
 
 namespace Gigamonkey::Stratum {
+    TEST(DifficultyTest, TestFastTargetToDiff) {
+        for (const uint256& t : random_targets(10000)) {
+            uint64 d = slow_target_to_difficulty(t);
+            EXPECT_EQ(difficulty(t).Value, d);
+            if (d != 0) EXPECT_EQ(uint256(difficulty{d}), uint256(work::compact{0x1d00ffff}.expand() / uint256{d}));
+        }
+    }
+    
     TEST(DifficultyTest, DiffTargetDiff) {
         for (uint32_t i = 0; i < 64; i++) {
             difficulty diff{1 << i};
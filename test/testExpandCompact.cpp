@@ -66,6 +66,28 @@ namespace Gigamonkey::work {
         
         EXPECT_EQ(a, b);*/
     }
+    
+    // known targets can be checked at compile time. 
+    static_assert(below(words{0, 0, 0, 0x7fffffffffffffff}, SuccessHalfBits));
+    static_assert(!below(SuccessHalfTarget, SuccessHalfBits));
+    static_assert(below(words{~uint64(0), ~uint64(0), ~uint64(0), 0x00000000fffeffff}, UnitBits));
+    static_assert(!below(words{0, 0, 0, 0x0000000100000000}, UnitBits));
+    
+    TEST(ExpandCompactTest, TestBelow) {
+        std::vector<compact> targets{SuccessHalf, SuccessQuarter, SuccessEighth, SuccessSixteenth, 
+            compact{UnitBits}, compact{0x1b0404cb}, compact{0x180d9bd0}, compact{3, 0xabcd}, compact{32, 0x800000}};
+        
+        for (const compact& c : targets) {
+            uint256 t = c.expand();
+            EXPECT_EQ(from_words(expand_words(uint32(c))), t);
+            
+            std::vector<uint256> hashes{uint256{0}, uint256{1}, t, uint256(t + 1), uint256(t - 1), 
+                uint256{"0xffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"}};
+            for (uint32 i = 0; i < 100; i++) hashes.push_back(Bitcoin::hash256(std::to_string(i)).Value >> (i * 2));
+            
+            for (const uint256& h : hashes) EXPECT_EQ(below(h, c), h < t);
+        }
+    }
 
 }
 
@@ -0,0 +1,59 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/hash.hpp>
+#include "messages.hpp"
+#include "gtest/gtest.h"
+
+namespace Gigamonkey::Bitcoin {
+
+    TEST(HashTest, TestHash256Many) {
+
+        // lengths around the block boundaries are the interesting ones.
+        std::vector<bytes> messages;
+        for (size_t i = 0; i <= 200; i++) messages.push_back(test_message(i, i));
+        for (uint32 i = 0; i < 50; i++) messages.push_back(test_message(1000 + 37 * i, i));
+
+        std::vector<bytes_view> views;
+        for (const bytes& b : messages) views.push_back(bytes_view(b));
+
+        // any number of messages, not just a multiple of the number of lanes.
+        for (size_t count : {0, 1, 3, 7, 9, 17, 251}) {
+            std::vector<bytes_view> x{views.begin(), views.begin() + count};
+            std::vector<digest256> digests = hash256_many(x);
+
+            ASSERT_EQ(digests.size(), count);
+            for (size_t i = 0; i < count; i++) EXPECT_EQ(digests[i], hash256(x[i]));
+        }
+
+        // every kernel that runs on this cpu, not only the one that is used.
+        std::vector<string> engines = hash256_engines();
+        ASSERT_FALSE(engines.empty());
+        EXPECT_EQ(engines.front(), hash256_engine());
+        for (const string& engine : engines)
+            for (size_t count : {1, 3, 7, 9, 17, 251}) {
+                std::vector<digest256> digests(count);
+                ASSERT_TRUE(hash256_many(engine, views.data(), digests.data(), count)) << engine;
+                for (size_t i = 0; i < count; i++) EXPECT_EQ(digests[i], hash256(views[i])) << engine;
+            }
+
+        EXPECT_FALSE(hash256_many("no such kernel", views.data(), nullptr, 0));
+
+    }
+
+    TEST(HashTest, TestHash256Prefix) {
+        bytes message = test_message(300, 7);
+
+        for (size_t prefix : {0, 1, 63, 64, 65, 128, 200})
+            for (size_t middle : {0, 5, 64, 90}) {
+                size_t rest = message.size() - prefix - middle;
+                hash256_prefix h{bytes_view{message.data(), prefix}};
+                bytes_view parts[2]{
+                    bytes_view{message.data() + prefix, middle},
+                    bytes_view{message.data() + prefix + middle, rest}};
+                EXPECT_EQ(h(parts, 2), hash256(bytes_view(message)));
+            }
+
+    }
+
+}
@@ -2,7 +2,11 @@
 // Distributed under the Open BSV software license, see the accompanying file LICENSE.
 
 #include <gigamonkey/merkle.hpp>
+#include "list_root.hpp"
 #include "gtest/gtest.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
 
 namespace Gigamonkey::Merkle {
     
@@ -93,4 +97,241 @@ namespace Gigamonkey::Merkle {
             EXPECT_FALSE(Dual.valid());
         }
     }
+    
+    TEST(MerkleTest, TestMultiproof) {
+        EXPECT_FALSE(multiproof{}.valid());
+        EXPECT_FALSE(multiproof{dual{}}.valid());
+        
+        for (uint32 width = 1; width <= 40; width++) {
+            std::vector<digest> leaves;
+            for (uint32 i = 0; i < width; i++) leaves.push_back(Bitcoin::hash256(std::to_string(i)));
+            server Server{leaves};
+            
+            // every third leaf starting from each of 0, 1, and 2 and then all of them. 
+            for (uint32 step : {3, 1}) for (uint32 start = 0; start < std::min(step, width); start++) {
+                map m{};
+                uint32 path_digests = 0;
+                for (uint32 i = start; i < width; i += step) {
+                    proof p = Server[leaves[i]];
+                    m = m.insert(entry(p.Branch));
+                    path_digests += p.Branch.Digests.size();
+                }
+                
+                multiproof Proof{dual{m, Server.root()}};
+                EXPECT_TRUE(Proof.valid());
+                EXPECT_LE(Proof.Digests.size(), path_digests);
+                
+                // with every leaf, the only digests needed are for nodes paired with themselves. 
+                if (step == 1) {
+                    uint32 odd = 0;
+                    for (uint32 w = width; w > 1; w = (w + 1) / 2) if (w & 1) odd++;
+                    EXPECT_EQ(Proof.Digests.size(), odd);
+                }
+                
+                multiproof Wrong = Proof;
+                Wrong.Leaves[0].Digest = Bitcoin::hash256("wrong");
+                EXPECT_FALSE(Wrong.valid());
+                
+                if (Proof.Digests.size() > 0) {
+                    Wrong = Proof;
+                    Wrong.Digests.pop_back();
+                    EXPECT_FALSE(Wrong.valid());
+                }
+            }
+        }
+    }
+    
+    TEST(MerkleTest, TestFlatRoot) {
+        for (uint32 width = 0; width <= 1100; width += (width < 70 ? 1 : 97)) {
+            leaf_digests l{};
+            std::vector<digest> v{};
+            for (uint32 i = 0; i < width; i++) {
+                digest d = Bitcoin::hash256(std::to_string(i));
+                l = l << d;
+                v.push_back(d);
+            }
+            
+            EXPECT_EQ(root(v), list_root(l));
+            EXPECT_EQ(root(l), list_root(l));
+        }
+    }
+    
+    TEST(MerkleTest, TestParallelServer) {
+        for (uint32 width : {1, 2, 3, 5, 8, 13, 64, 100, 1000, 4097}) {
+            leaf_digests l{};
+            for (uint32 i = 0; i < width; i++) l = l << Bitcoin::hash256(std::to_string(i));
+            
+            server expected{l};
+            for (uint32 threads : {2, 3, 4, 16}) {
+                server x{l, threads};
+                EXPECT_EQ(x, expected);
+                EXPECT_EQ(tree::make(l, threads), tree::make(l));
+            }
+        }
+    }
+    
+    // a unique file in the temporary directory that is removed 
+    // when the test is over, even if it fails. 
+    struct temporary_file {
+        std::filesystem::path Path;
+        
+        explicit temporary_file(const string& name) : Path{std::filesystem::temp_directory_path() / 
+            (name + "_" + std::to_string(std::random_device{}()) + ".dat")} {}
+        
+        ~temporary_file() {
+            std::error_code err;
+            std::filesystem::remove(Path, err);
+        }
+    };
+    
+    TEST(MerkleTest, TestServerFile) {
+        temporary_file file{"merkle_server_test"};
+        string filename = file.Path.string();
+        
+        EXPECT_EQ(server::map(filename + ".missing").Width, 0);
+        
+        for (uint32 width : {1, 2, 7, 100, 1025}) {
+            leaf_digests l{};
+            for (uint32 i = 0; i < width; i++) l = l << Bitcoin::hash256(std::to_string(i));
+            
+            server Server{l};
+            
+            // leaves are at level zero and the root is at the top. 
+            uint32 i = 0;
+            for (const digest& d : l) EXPECT_EQ(Server(0, i++), d);
+            EXPECT_EQ(Server(Server.Height - 1, 0), Server.root());
+            
+            ASSERT_TRUE(Server.write(filename));
+            server Mapped = server::map(filename);
+            
+            EXPECT_EQ(Mapped, Server);
+            EXPECT_EQ(Mapped.proofs(), Server.proofs());
+            for (const digest& d : l) EXPECT_EQ(Mapped[d], Server[d]);
+            EXPECT_FALSE(Mapped[Bitcoin::hash256("Z")].valid());
+        }
+        
+        // the index is at the end of the file. A slot that points past the
+        // leaves, or an index with no empty slots, is not accepted. 
+        auto corrupt = [&filename](std::streamoff slots, uint32 value) {
+            std::fstream file{filename, std::ios::binary | std::ios::in | std::ios::out};
+            file.seekp(-4 * slots, std::ios::end);
+            for (std::streamoff i = 0; i < slots; i++) {
+                uint32_little x{value};
+                file.write(reinterpret_cast<const char*>(x.data()), 4);
+            }
+        };
+        
+        leaf_digests l{};
+        for (uint32 i = 0; i < 100; i++) l = l << Bitcoin::hash256(std::to_string(i));
+        server Server{l};
+        
+        ASSERT_TRUE(Server.write(filename));
+        corrupt(1, 101);
+        EXPECT_EQ(server::map(filename).Width, 0);
+        
+        ASSERT_TRUE(Server.write(filename));
+        
+        // everything after the header and the 202 nodes of the tree. 
+        std::streamoff slots = 0;
+        {
+            std::ifstream file{filename, std::ios::binary | std::ios::ate};
+            slots = (std::streamoff(file.tellg()) - 32 - 32 * 202) / 4;
+        }
+        
+        corrupt(slots, 1);
+        EXPECT_EQ(server::map(filename).Width, 0);
+        
+        ASSERT_TRUE(Server.write(filename));
+        EXPECT_EQ(server::map(filename), Server);
+    }
+    
+    TEST(MerkleTest, TestAllPaths) {
+        for (uint32 width : {1, 2, 3, 6, 11, 64, 333}) {
+            leaf_digests l{};
+            for (uint32 i = 0; i < width; i++) l = l << Bitcoin::hash256(std::to_string(i));
+            
+            server Server{l};
+            uint32 size = Server.Height - 1;
+            
+            std::vector<digest> paths = Server.all_paths();
+            ASSERT_EQ(paths.size(), width * size);
+            
+            uint32 i = 0;
+            for (const digest& d : l) {
+                proof p = Server[d];
+                EXPECT_TRUE(p.valid());
+                
+                digests expected = p.Branch.Digests;
+                for (uint32 k = 0; k < size; k++) {
+                    EXPECT_EQ(paths[i * size + k], expected.first());
+                    expected = expected.rest();
+                }
+                
+                i++;
+            }
+            
+            uint32 calls = 0;
+            Server.all_paths([&](uint32 index, const digest* path) {
+                EXPECT_EQ(index, calls);
+                EXPECT_TRUE(std::equal(path, path + size, paths.begin() + index * size));
+                calls++;
+            });
+            EXPECT_EQ(calls, width);
+        }
+    }
+    
+    TEST(MerkleTest, TestAccumulator) {
+        accumulator Accumulator{};
+        EXPECT_EQ(Accumulator.root(), digest{});
+        
+        leaf_digests l{};
+        for (uint32 width = 1; width <= 300; width++) {
+            digest d = Bitcoin::hash256(std::to_string(width));
+            l = l << d;
+            Accumulator << d;
+            
+            EXPECT_EQ(Accumulator.Width, width);
+            EXPECT_EQ(Accumulator.root(), root(l));
+            
+            proof p = server{l}[l.first()];
+            EXPECT_EQ(Accumulator.coinbase(), path(p.Branch));
+            
+            // the coinbase path works with any first leaf. 
+            digest coinbase = Bitcoin::hash256("coinbase");
+            leaf_digests replaced = leaf_digests{} << coinbase;
+            for (const digest& x : l.rest()) replaced = replaced << x;
+            EXPECT_EQ(Accumulator.coinbase().derive_root(coinbase), root(replaced));
+        }
+    }
+    
+    TEST(MerkleTest, TestCoinbaseCache) {
+        coinbase_cache Cache{};
+        EXPECT_EQ(Cache.width(), 1);
+        EXPECT_EQ(Cache.path(), digests{});
+        
+        digest coinbase = Bitcoin::hash256("coinbase");
+        std::vector<digest> leaves{coinbase};
+        for (uint32 i = 1; i < 200; i += 1 + i % 5) {
+            // append a few at a time. 
+            std::vector<digest> transactions;
+            for (uint32 j = 0; j <= i % 5; j++) transactions.push_back(Bitcoin::hash256(std::to_string(i + j)));
+            Cache.append(transactions);
+            leaves.insert(leaves.end(), transactions.begin(), transactions.end());
+            
+            ASSERT_EQ(Cache.width(), leaves.size());
+            EXPECT_EQ(Cache.root(coinbase), root(leaves));
+            EXPECT_EQ(path(0, Cache.path()), path(server{leaves}[coinbase].Branch));
+            
+            // replace one in the middle. 
+            uint32 index = 1 + i % (leaves.size() - 1);
+            leaves[index] = Bitcoin::hash256(std::to_string(i) + "replaced");
+            EXPECT_TRUE(Cache.replace(index, leaves[index]));
+            EXPECT_EQ(Cache.root(coinbase), root(leaves));
+            EXPECT_EQ(path(0, Cache.path()).derive_root(coinbase), root(leaves));
+        }
+        
+        EXPECT_FALSE(Cache.replace(0, coinbase));
+        EXPECT_FALSE(Cache.replace(Cache.width(), coinbase));
+    }
+    
 }
@@ -5,6 +5,14 @@
 #include <gigamonkey/stratum/mining_authorize.hpp>
 #include <gigamonkey/stratum/mining_subscribe.hpp>
 #include <gigamonkey/stratum/job.hpp>
+#include <gigamonkey/stratum/validator.hpp>
+#include <gigamonkey/stratum/share_set.hpp>
+#include <gigamonkey/stratum/vardiff.hpp>
+#include <gigamonkey/stratum/stats.hpp>
+#include <gigamonkey/stratum/codec.hpp>
+#include <gigamonkey/stratum/job_registry.hpp>
+#include <random>
+#include <thread>
 #include "gtest/gtest.h"
 
 namespace Gigamonkey::Stratum {
@@ -229,3 +237,364 @@ namespace Gigamonkey::Stratum::mining {
 
 }
 
+namespace Gigamonkey::Stratum {
+    
+    TEST(StratumTest, TestShareValidator) {
+        work::puzzle puzzle{2, sha256(std::string{"previous"}), work::compact{32, 0x400000}, 
+            Merkle::path{0, Merkle::digests{} << sha256(std::string{"a"}) << sha256(std::string{"b"})}, 
+            bytes(70, 0x11), bytes(30, 0x22)};
+        
+        mining::notify::parameters notify{1, puzzle, Bitcoin::timestamp(1000), true};
+        worker w{"dk", session_id{0x1234}};
+        job j{w, notify};
+        
+        share_validator validator{4};
+        EXPECT_TRUE(validator.notify(notify));
+        
+        std::vector<submission> submissions;
+        std::vector<bool> expected;
+        for (uint32 i = 0; i < 256; i++) {
+            share x{w.Name, notify.ID, uint64_big{i / 16}, Bitcoin::timestamp(1000 + i % 3), nonce{i}};
+            submissions.push_back(submission{w.ExtraNonce1, x, difficulty{1}});
+            expected.push_back(solved{j, x}.valid());
+        }
+        
+        // shares that are not blocks do not meet difficulty 1. 
+        for (uint32 i = 0; i < 16; i++) {
+            share_result r = validator.validate(submissions[i]);
+            EXPECT_EQ(r.Status, expected[i] ? share_accepted : share_rejected);
+            EXPECT_EQ(r.Solved, expected[i]);
+            if (expected[i]) EXPECT_GE(r.Difficulty, puzzle.Candidate.Target.difficulty());
+        }
+        
+        // the first 16 have been seen already. 
+        std::vector<share_result> results = validator.validate(submissions);
+        ASSERT_EQ(results.size(), submissions.size());
+        for (uint32 i = 0; i < results.size(); i++) 
+            EXPECT_EQ(results[i].Status, !expected[i] ? share_rejected : i < 16 ? share_duplicate : share_accepted);
+        
+        // a clean job retires the others. 
+        mining::notify::parameters next{2, puzzle, Bitcoin::timestamp(1001), false};
+        EXPECT_TRUE(validator.notify(next));
+        EXPECT_EQ(validator.jobs(), 2);
+        next.ID = 3;
+        next.Clean = true;
+        EXPECT_TRUE(validator.notify(next));
+        EXPECT_EQ(validator.jobs(), 1);
+        EXPECT_EQ(validator.validate(submissions[0]).Status, share_stale);
+        
+        // a share for a job that never existed is rejected. 
+        share z = submissions[0].Share;
+        z.JobID = 99;
+        EXPECT_EQ(validator.validate(submission{w.ExtraNonce1, z, difficulty{1}}).Status, share_rejected);
+        
+        // the hash is compared with the target exactly. 
+        job k{w, next};
+        share y{w.Name, next.ID, uint64_big{99}, Bitcoin::timestamp(1001), nonce{0}};
+        while (solved{k, y}.valid()) y.Share.Nonce++;
+        uint256 hash = solved{k, y}.proof().string().hash();
+        uint256 above = hash;
+        ++above;
+        EXPECT_EQ(validator.validate(submission{w.ExtraNonce1, y, difficulty{1}, hash}).Status, share_rejected);
+        EXPECT_EQ(validator.validate(submission{w.ExtraNonce1, y, difficulty{1}, above}).Status, share_accepted);
+        
+        // a job that has been removed is stale. 
+        EXPECT_TRUE(validator.remove(next.ID));
+        EXPECT_FALSE(validator.remove(next.ID));
+        EXPECT_EQ(validator.jobs(), 0);
+        EXPECT_EQ(validator.validate(submission{w.ExtraNonce1, y, difficulty{1}, above}).Status, share_stale);
+    }
+    
+    TEST(StratumTest, TestShareSet) {
+        // every share is inserted by several threads at once. 
+        const uint32 count = 20000;
+        share_set set{count, 99};
+        std::atomic<uint32> inserted{0};
+        std::atomic<uint32> duplicates{0};
+        
+        std::vector<std::thread> threads;
+        for (uint32 k = 0; k < 4; k++) threads.emplace_back([&set, &inserted, &duplicates, k]() {
+            for (uint32 i = 0; i < count; i++) {
+                uint32 x = (i + k * 5000) % count;
+                auto r = set.insert(session_id{x % 7}, work::share{Bitcoin::timestamp(x % 3 + 1), nonce{x}, uint64_big{x / 2}});
+                if (r == share_set::inserted) inserted++;
+                else if (r == share_set::duplicate) duplicates++;
+            }
+        });
+        for (std::thread& t : threads) t.join();
+        
+        EXPECT_EQ(inserted, count);
+        EXPECT_EQ(duplicates, 3 * count);
+        EXPECT_EQ(set.size(), count);
+        EXPECT_TRUE(set.contains(session_id{1}, work::share{Bitcoin::timestamp(2), nonce{1}, uint64_big{0}}));
+        EXPECT_FALSE(set.contains(session_id{2}, work::share{Bitcoin::timestamp(2), nonce{1}, uint64_big{0}}));
+        
+        // no more shares can be added once the set is full. 
+        EXPECT_EQ(set.insert(session_id{count}, work::share{Bitcoin::timestamp(1), nonce{count}, uint64_big{0}}), share_set::exhausted);
+        EXPECT_EQ(set.insert(session_id{1}, work::share{Bitcoin::timestamp(2), nonce{1}, uint64_big{0}}), share_set::duplicate);
+    }
+    
+    TEST(StratumTest, TestVardiff) {
+        using clock = vardiff::clock;
+        std::mt19937_64 random{11};
+        
+        clock::time_point now{};
+        vardiff v{difficulty{100}, now};
+        
+        // a miner with the given hashpower, whose shares arrive at random. 
+        auto mine = [&random, &now, &v](double hashpower, uint32 shares) {
+            for (uint32 i = 0; i < shares; i++) {
+                std::exponential_distribution<double> wait{hashpower / double(v.Difficulty.Value)};
+                now += std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(wait(random)));
+                auto message = v.share(now);
+                if (message) {
+                    EXPECT_TRUE(message->valid());
+                    EXPECT_EQ(difficulty(*message), v.Difficulty);
+                }
+            }
+        };
+        
+        // the difficulty should settle near hashpower / SharesPerSecond. 
+        mine(1000, 2000);
+        EXPECT_GT(double(v.hashpower()), 300);
+        EXPECT_LT(double(v.hashpower()), 3000);
+        EXPECT_GT(v.Difficulty.Value, 2500);
+        EXPECT_LT(v.Difficulty.Value, 10000);
+        
+        mine(100, 1000);
+        EXPECT_GT(v.Difficulty.Value, 250);
+        EXPECT_LT(v.Difficulty.Value, 1000);
+        
+        // a miner that goes quiet has its difficulty lowered. 
+        auto message = v.update(now + std::chrono::seconds(600));
+        EXPECT_TRUE(bool(message));
+        EXPECT_LT(v.Difficulty.Value, 250);
+    }
+    
+    TEST(StratumTest, TestStats) {
+        using clock = pool_stats::clock;
+        clock::time_point start{};
+        
+        // buckets of one second, so the window is a minute. 
+        pool_stats stats{start, 1};
+        stats.job(5, start);
+        auto w = stats.worker("w", start);
+        EXPECT_EQ(w, stats.worker("w", start));
+        
+        auto result = [](share_status s) {
+            return share_result{s, work::difficulty{}, false};
+        };
+        
+        // one share per second for 100 seconds. 
+        submission x{session_id{1}, share{"w", 5, work::share{}}, difficulty{10}};
+        for (int i = 0; i < 100; i++) stats.record(*w, x, result(share_accepted), start + std::chrono::seconds(i));
+        stats.record(*w, x, result(share_rejected), start);
+        stats.record(*w, x, result(share_duplicate), start);
+        
+        // a share for a job that is not being tracked only counts toward the pool and the worker. 
+        submission y{session_id{1}, share{"w", 6, work::share{}}, difficulty{10}};
+        stats.record(*w, y, result(share_stale), start);
+        
+        auto snapshot = stats.read(start + std::chrono::seconds(100));
+        EXPECT_EQ(snapshot.Pool.Accepted, 100);
+        EXPECT_EQ(snapshot.Pool.Rejected, 1);
+        EXPECT_EQ(snapshot.Pool.Duplicate, 1);
+        EXPECT_EQ(snapshot.Pool.Stale, 1);
+        EXPECT_EQ(snapshot.Pool.Work, work::difficulty{1000});
+        EXPECT_NEAR(snapshot.Pool.Hashpower.Value, 10, .01);
+        EXPECT_EQ(snapshot.Workers["w"].Accepted, 100);
+        EXPECT_EQ(snapshot.Jobs.size(), 1);
+        EXPECT_EQ(snapshot.Jobs[5].Accepted, 100);
+        EXPECT_EQ(snapshot.Jobs[5].Stale, 0);
+        
+        // nothing has happened for a while. 
+        EXPECT_EQ(stats.read(start + std::chrono::seconds(200)).Pool.Hashpower.Value, 0);
+        
+        // a new job takes the place of the old one in the ring. 
+        stats.job(5 + pool_stats::Jobs, start);
+        EXPECT_EQ(stats.read(start).Jobs.count(5), 0);
+        
+        json j = snapshot;
+        EXPECT_EQ(j["pool"]["accepted"], 100);
+        EXPECT_EQ(j["workers"]["w"]["stale"], 1);
+        EXPECT_EQ(j["jobs"]["5"]["work"], 1000.);
+        
+        // counts are exact when shares are recorded from many threads. 
+        share_stats concurrent{start};
+        std::vector<std::thread> threads;
+        for (int k = 0; k < 4; k++) threads.emplace_back([&concurrent, start]() {
+            for (int i = 0; i < 10000; i++) concurrent.record(i % 2 ? share_accepted : share_rejected, work::difficulty{1}, start + std::chrono::milliseconds(i));
+        });
+        for (std::thread& t : threads) t.join();
+        auto counts = concurrent.read(start + std::chrono::seconds(10));
+        EXPECT_EQ(counts.Accepted, 20000);
+        EXPECT_EQ(counts.Rejected, 20000);
+        EXPECT_EQ(counts.Work, work::difficulty{20000});
+    }
+    
+    TEST(StratumTest, TestCodec) {
+        std::vector<share> shares{
+            share{"w", 1, uint64_big{1}, Bitcoin::timestamp(1000), nonce{2}},
+            share{"worker.1", 0xfedcba98, uint64_big{0x0123456789abcdef}, Bitcoin::timestamp(1600000000), nonce{0xffffffff}},
+            share{"a \"quoted\"\\ name\twith\ncontrol\r", 7, uint64_big{}, Bitcoin::timestamp(0), nonce{0}}};
+        
+        string buffer;
+        for (const share& x : shares) {
+            // what is written is exactly what the json types write.
+            buffer.clear();
+            codec::encode(buffer, 23, x);
+            EXPECT_EQ(buffer, mining::submit_request(23, x).dump());
+            
+            request_id id;
+            share read;
+            EXPECT_TRUE(codec::decode(buffer, id, read));
+            EXPECT_EQ(id, 23);
+            EXPECT_EQ(read, x);
+        }
+        
+        std::vector<mining::notify::parameters> jobs{
+            mining::notify::parameters{7, work::puzzle{2, sha256(std::string{"previous"}), work::compact{32, 0x400000},
+                Merkle::path{}, bytes(70, 0x11), bytes(30, 0x22)}, Bitcoin::timestamp(1000), true},
+            mining::notify::parameters{0xabcdef01, work::puzzle{0x20000000, sha256(std::string{"previous"}), work::compact{29, 0x123456},
+                Merkle::path{0, Merkle::digests{} << sha256(std::string{"a"}) << sha256(std::string{"b"}) << sha256(std::string{"c"})},
+                bytes{}, bytes(1, 0xff)}, Bitcoin::timestamp(1600000000), false}};
+        
+        for (const auto& p : jobs) {
+            buffer.clear();
+            codec::encode(buffer, p);
+            EXPECT_EQ(buffer, mining::notify{p}.dump());
+            
+            mining::notify::parameters read;
+            EXPECT_TRUE(codec::decode(buffer, read));
+            EXPECT_EQ(read, p);
+            
+            // storage is reused from one job to the next.
+            EXPECT_TRUE(codec::decode(mining::notify{jobs[0]}.dump(2), read));
+            EXPECT_EQ(read, jobs[0]);
+        }
+        
+        for (bool b : {true, false}) {
+            buffer.clear();
+            codec::encode(buffer, 99, b);
+            EXPECT_EQ(buffer, boolean_response(99, b).dump());
+            
+            request_id id;
+            bool read;
+            EXPECT_TRUE(codec::decode(buffer, id, read));
+            EXPECT_EQ(id, 99);
+            EXPECT_EQ(read, b);
+        }
+        
+        // messages are written one after another into the same buffer.
+        buffer.clear();
+        codec::encode(buffer, 1, true);
+        codec::encode(buffer, 2, false);
+        EXPECT_EQ(buffer, boolean_response(1, true).dump() + boolean_response(2, false).dump());
+        
+        // whitespace, the order of keys, and extra keys are all allowed.
+        request_id id;
+        share x;
+        EXPECT_TRUE(codec::decode(R"( { "params" : [ "w", "00000001", "0000000000000001", "000003e8", "00000002" ],
+            "extra": {"a": [1, "]}"]}, "method": "mining.submit", "id": 5 } )", id, x));
+        EXPECT_EQ(id, 5);
+        EXPECT_EQ(x, shares[0]);
+        
+        bool result;
+        EXPECT_TRUE(codec::decode(R"({"result":true,"id":3,"error":null})", id, result));
+        EXPECT_TRUE(result);
+        
+        // anything else is left for the json types.
+        EXPECT_FALSE(codec::decode(R"({"id":5,"method":"mining.submit","params":["w","00000001","0000000000000001","000003e8","0000002"]})", id, x));
+        EXPECT_FALSE(codec::decode(R"({"id":5,"method":"mining.submit","params":["w","00000001","0000000000000001","000003e8","0000000g"]})", id, x));
+        EXPECT_FALSE(codec::decode(R"({"id":5,"method":"mining.submit","params":["\u0077","00000001","0000000000000001","000003e8","00000002"]})", id, x));
+        EXPECT_FALSE(codec::decode(R"({"id":5,"method":"mining.authorize","params":["w","00000001","0000000000000001","000003e8","00000002"]})", id, x));
+        EXPECT_FALSE(codec::decode(R"({"method":"mining.submit","params":["w","00000001","0000000000000001","000003e8","00000002"]})", id, x));
+        EXPECT_FALSE(codec::decode(R"({"id":5,"method":"mining.submit","params":["w","00000001","0000000000000001","000003e8","00000002"]} x)", id, x));
+        EXPECT_FALSE(codec::decode(R"({"error":[21,"Job not found"],"id":3,"result":null})", id, result));
+        EXPECT_FALSE(codec::decode(R"({"error":null,"id":3})", id, result));
+        mining::notify::parameters job;
+        EXPECT_FALSE(codec::decode(R"({"id":3,"method":"mining.notify","params":[]})", job));
+    }
+    
+    TEST(StratumTest, TestJobRegistry) {
+        auto job = [](job_id id, bool clean, size_t size = 100) -> mining::notify::parameters {
+            return mining::notify::parameters{id, work::puzzle{2, sha256(std::string{"previous"}), work::compact{32, 0x400000},
+                Merkle::path{}, bytes(size, 0x11), bytes(30, 0x22)}, Bitcoin::timestamp(1000), clean};
+        };
+        
+        job_registry registry{1 << 20, 4, 16};
+        EXPECT_EQ(registry.find(1).Status, job_registry::unknown);
+        EXPECT_FALSE(registry.notify(mining::notify::parameters{}));
+        
+        for (job_id i = 1; i <= 5; i++) EXPECT_TRUE(registry.notify(job(i, i == 1)));
+        EXPECT_EQ(registry.jobs(), 5);
+        
+        auto found = registry.find(3);
+        ASSERT_EQ(found.Status, job_registry::found);
+        EXPECT_EQ(found.Job->ID, 3);
+        EXPECT_EQ(found.Job->Puzzle, work::puzzle(job(3, false)));
+        
+        // a clean job removes every job before it at once.
+        EXPECT_TRUE(registry.notify(job(6, true)));
+        EXPECT_EQ(registry.jobs(), 1);
+        EXPECT_EQ(registry.find(6).Status, job_registry::found);
+        EXPECT_EQ(registry.find(5).Status, job_registry::stale);
+        EXPECT_EQ(registry.find(2).Status, job_registry::stale);
+        EXPECT_EQ(registry.find(7).Status, job_registry::unknown);
+        
+        // only the last max retired ids are remembered.
+        EXPECT_EQ(registry.find(1).Status, job_registry::unknown);
+        
+        // a job that has been looked up is still there for whoever has it.
+        EXPECT_EQ(found.Job->ID, 3);
+        
+        // a job that is removed becomes stale.
+        EXPECT_TRUE(registry.remove(6));
+        EXPECT_FALSE(registry.remove(6));
+        EXPECT_EQ(registry.jobs(), 0);
+        EXPECT_EQ(registry.find(6).Status, job_registry::stale);
+        EXPECT_TRUE(registry.notify(job(6, true)));
+        
+        // the oldest jobs are removed to stay under the max size.
+        size_t size = registry.size();
+        job_registry capped{3 * size, 100, 16};
+        for (job_id i = 1; i <= 10; i++) capped.notify(job(i, false));
+        EXPECT_EQ(capped.jobs(), 3);
+        EXPECT_LE(capped.size(), 3 * size);
+        EXPECT_EQ(capped.find(8).Status, job_registry::found);
+        EXPECT_EQ(capped.find(7).Status, job_registry::stale);
+        
+        // the newest job is kept no matter how big it is.
+        capped.notify(job(11, false, 100000));
+        EXPECT_EQ(capped.jobs(), 1);
+        EXPECT_EQ(capped.find(11).Status, job_registry::found);
+        
+        // a job with an id that is already in use replaces the old one.
+        capped.notify(job(11, false));
+        EXPECT_EQ(capped.jobs(), 1);
+        EXPECT_EQ(capped.size(), size);
+        
+        // an id that is used again is no longer stale.
+        capped.notify(job(9, false));
+        EXPECT_EQ(capped.find(9).Status, job_registry::found);
+        
+        // jobs are looked up while new ones are added.
+        job_registry concurrent{1 << 24, 1024, 16};
+        std::atomic<bool> done{false};
+        std::vector<std::thread> threads;
+        for (int k = 0; k < 4; k++) threads.emplace_back([&concurrent, &done]() {
+            while (!done) for (job_id i = 0; i < 1000; i++) {
+                auto x = concurrent.find(i);
+                if (x.Status == job_registry::found) EXPECT_EQ(x.Job->ID, i);
+            }
+        });
+        for (job_id i = 0; i < 1000; i++) concurrent.notify(job(i, i % 50 == 0));
+        done = true;
+        for (std::thread& t : threads) t.join();
+        
+        EXPECT_EQ(concurrent.jobs(), 50);
+        EXPECT_EQ(concurrent.find(949).Status, job_registry::stale);
+        EXPECT_EQ(concurrent.find(950).Status, job_registry::found);
+    }
+    
+}
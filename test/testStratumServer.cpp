@@ -0,0 +1,335 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/server.hpp>
+#include <gigamonkey/stratum/client.hpp>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <set>
+#include <thread>
+#include "gtest/gtest.h"
+
+namespace Gigamonkey::Stratum {
+
+    namespace asio = boost::asio;
+    using tcp = asio::ip::tcp;
+
+    // accepts every worker but "bad" and every share with an even nonce.
+    struct test_pool : server::pool {
+        std::atomic<uint32> Shares{0};
+
+        bool authorize(const worker&, const mining::authorize_request::parameters& p) override {
+            return p.Username != "bad";
+        }
+
+        bool submit(const worker&, const share& x) override {
+            Shares++;
+            return uint32(x.Share.Nonce) % 2 == 0;
+        }
+    };
+
+    // a blocking client that speaks to the server over loopback.
+    struct test_client {
+        asio::io_context IO;
+        tcp::socket Socket;
+        asio::streambuf Input;
+
+        test_client(uint16 port) : IO{}, Socket{IO}, Input{} {
+            Socket.connect(tcp::endpoint{asio::ip::make_address("127.0.0.1"), port});
+        }
+
+        void send(const string& x) {
+            asio::write(Socket, asio::buffer(x));
+        }
+
+        void send(const json& j) {
+            send(j.dump() + "\n");
+        }
+
+        json receive() {
+            size_t n = asio::read_until(Socket, Input, '\n');
+            auto data = Input.data();
+            string message(asio::buffers_begin(data), asio::buffers_begin(data) + n);
+            Input.consume(n);
+            return json::parse(message);
+        }
+
+        bool closed() {
+            boost::system::error_code err;
+            asio::read_until(Socket, Input, '\n', err);
+            return bool(err);
+        }
+    };
+
+    TEST(StratumServerTest, TestLoopback) {
+        work::puzzle puzzle{2, sha256(std::string{"previous"}), work::compact{32, 0x400000},
+            Merkle::path{0, Merkle::digests{} << sha256(std::string{"a"}) << sha256(std::string{"b"})},
+            bytes(70, 0x11), bytes(30, 0x22)};
+
+        test_pool pool;
+        server::options options;
+        options.Address = "127.0.0.1";
+        options.Threads = 4;
+        options.Difficulty = difficulty{32};
+
+        server s{pool, options};
+        ASSERT_TRUE(s.start());
+        EXPECT_NE(s.port(), 0);
+
+        {
+            test_client c{s.port()};
+
+            // nothing can be done before subscribing.
+            c.send(mining::submit_request{1, share{"w", 1, uint64_big{1}, Bitcoin::timestamp(1000), nonce{2}}});
+            response r{c.receive()};
+            EXPECT_EQ(r.id(), 1);
+            ASSERT_TRUE(r.is_error());
+            EXPECT_EQ(r.error()->Code, unauthorized_worker);
+
+            c.send(mining::authorize_request{2, "w"});
+            r = response{c.receive()};
+            ASSERT_TRUE(r.is_error());
+            EXPECT_EQ(r.error()->Code, not_subscribed);
+
+            c.send(mining::subscribe_request{3, "test"});
+            mining::subscribe_response subscribed{c.receive()};
+            EXPECT_TRUE(subscribed.valid());
+            EXPECT_EQ(subscribed.id(), 3);
+
+            c.send(mining::authorize_request{4, "bad"});
+            EXPECT_EQ(response{c.receive()}.result(), false);
+
+            // once authorized, the worker is sent the difficulty and then the jobs.
+            c.send(mining::authorize_request{5, "w"});
+            EXPECT_EQ(response{c.receive()}.result(), true);
+
+            mining::set_difficulty d{c.receive()};
+            EXPECT_TRUE(d.valid());
+            EXPECT_EQ(difficulty(d), difficulty{32});
+
+            mining::notify::parameters job{7, puzzle, Bitcoin::timestamp(1000), true};
+            s.notify(job);
+            notification n{c.receive()};
+            EXPECT_EQ(n.method(), mining_notify);
+            EXPECT_EQ(mining::notify::deserialize(n.params()), job);
+
+            c.send(mining::submit_request{6, share{"w", 7, uint64_big{1}, Bitcoin::timestamp(1000), nonce{2}}});
+            EXPECT_EQ(response{c.receive()}.result(), true);
+
+            c.send(mining::submit_request{7, share{"w", 7, uint64_big{1}, Bitcoin::timestamp(1000), nonce{3}}});
+            EXPECT_EQ(response{c.receive()}.result(), false);
+
+            // shares can only be submitted for the authorized worker.
+            c.send(mining::submit_request{8, share{"v", 7, uint64_big{1}, Bitcoin::timestamp(1000), nonce{4}}});
+            r = response{c.receive()};
+            ASSERT_TRUE(r.is_error());
+            EXPECT_EQ(r.error()->Code, unauthorized_worker);
+
+            EXPECT_EQ(pool.Shares, 2);
+
+            // a client that does not send json is disconnected.
+            c.send(string{"garbage\n"});
+            EXPECT_TRUE(c.closed());
+        }
+
+        // many connections are spread over the threads, and each gets its own extra nonce 1.
+        std::vector<std::unique_ptr<test_client>> clients;
+        for (int i = 0; i < 100; i++) {
+            clients.emplace_back(new test_client{s.port()});
+            clients.back()->send(mining::subscribe_request{1, "test"});
+            clients.back()->send(mining::authorize_request{2, "w"});
+        }
+
+        std::set<uint32> extra_nonces;
+        for (auto& c : clients) {
+            extra_nonces.insert(uint32(mining::subscribe_response{c->receive()}.extra_nonce_1()));
+            EXPECT_EQ(response{c->receive()}.result(), true);
+            EXPECT_EQ(notification{c->receive()}.method(), mining_set_difficulty);
+            EXPECT_EQ(notification{c->receive()}.method(), mining_notify);
+        }
+
+        EXPECT_EQ(extra_nonces.size(), 100);
+
+        mining::notify::parameters next{8, puzzle, Bitcoin::timestamp(1001), false};
+        s.notify(next);
+        for (auto& c : clients) EXPECT_EQ(mining::notify::deserialize(notification{c->receive()}.params()), next);
+
+        // jobs sent in quick succession arrive in order.
+        for (uint32 k = 100; k < 200; k++) s.notify(mining::notify::parameters{k, puzzle, Bitcoin::timestamp(1001), false});
+        for (auto& c : clients) for (uint32 k = 100; k < 200; k++)
+            EXPECT_EQ(mining::notify::deserialize(notification{c->receive()}.params()).ID, k);
+
+        // a message that is too long closes the connection.
+        {
+            test_client c{s.port()};
+            c.send(string(options.MaxMessageSize + 1, 'x'));
+            EXPECT_TRUE(c.closed());
+        }
+
+        s.stop();
+        for (auto& c : clients) EXPECT_TRUE(c->closed());
+    }
+
+    TEST(StratumServerTest, TestClientPipelining) {
+        const uint32 count = 50;
+        mining::notify::parameters job{3, work::puzzle{2, sha256(std::string{"previous"}), work::compact{32, 0x400000},
+            Merkle::path{}, bytes(70, 0x11), bytes(30, 0x22)}, Bitcoin::timestamp(1000), true};
+
+        // a stand-in server that reads every share before answering
+        // any of them, and then answers them in reverse order.
+        asio::io_context io;
+        tcp::acceptor acceptor{io, tcp::endpoint{asio::ip::make_address("127.0.0.1"), 0}};
+        std::thread stand_in{[&io, &acceptor, &job, count]() {
+            tcp::socket socket{io};
+            acceptor.accept(socket);
+            asio::streambuf input;
+
+            auto receive = [&socket, &input]() -> request {
+                size_t n = asio::read_until(socket, input, '\n');
+                auto data = input.data();
+                string message(asio::buffers_begin(data), asio::buffers_begin(data) + n);
+                input.consume(n);
+                return request{json::parse(message)};
+            };
+
+            auto send = [&socket](const json& j) {
+                string x = j.dump() + "\n";
+                asio::write(socket, asio::buffer(x));
+            };
+
+            request r = receive();
+            EXPECT_EQ(r.method(), mining_subscribe);
+            send(mining::subscribe_response{r.id(), {mining::subscription{mining_notify, 5}}, session_id{5}, 8});
+
+            r = receive();
+            EXPECT_EQ(r.method(), mining_authorize);
+            send(boolean_response{r.id(), true});
+            send(mining::set_difficulty{difficulty{64}});
+            send(mining::notify{job});
+
+            std::vector<request> shares;
+            for (uint32 i = 0; i < count; i++) shares.push_back(receive());
+            for (auto x = shares.rbegin(); x != shares.rend(); x++)
+                send(boolean_response{x->id(), uint32(mining::submit_request::deserialize(x->params()).Share.Nonce) % 2 == 0});
+
+            // wait for the client to hang up.
+            boost::system::error_code err;
+            asio::read_until(socket, input, '\n', err);
+        }};
+
+        client::options options;
+        options.Port = acceptor.local_endpoint().port();
+        options.Username = "w";
+        client c{options};
+
+        std::promise<mining::notify::parameters> notified;
+        c.Notify = [&notified](const mining::notify::parameters& p) {
+            notified.set_value(p);
+        };
+
+        ASSERT_TRUE(c.start());
+        EXPECT_EQ(c.extra_nonce_1(), session_id{5});
+        EXPECT_EQ(c.extra_nonce_2_size(), 8);
+        EXPECT_EQ(notified.get_future().get(), job);
+        EXPECT_EQ(c.share_difficulty(), difficulty{64});
+
+        // every share is sent before any response arrives.
+        std::vector<std::future<bool>> accepted;
+        for (uint32 i = 0; i < count; i++)
+            accepted.push_back(c.submit(share{"w", 3, uint64_big{1}, Bitcoin::timestamp(1000), nonce{i}}));
+        for (uint32 i = 0; i < count; i++) EXPECT_EQ(accepted[i].get(), i % 2 == 0);
+        EXPECT_EQ(c.pending(), 0);
+
+        // requests that are never answered fail when the client stops.
+        auto unanswered = c.submit(share{"w", 3, uint64_big{1}, Bitcoin::timestamp(1000), nonce{0}});
+        c.stop();
+        EXPECT_FALSE(unanswered.get());
+        EXPECT_FALSE(c.connected());
+        EXPECT_FALSE(c.submit(share{"w", 3, uint64_big{1}, Bitcoin::timestamp(1000), nonce{0}}).get());
+
+        stand_in.join();
+    }
+
+    TEST(StratumServerTest, TestClientServer) {
+        test_pool pool;
+        server::options options;
+        options.Address = "127.0.0.1";
+        options.Threads = 2;
+        server s{pool, options};
+        ASSERT_TRUE(s.start());
+
+        client::options bad;
+        bad.Port = s.port();
+        bad.Username = "bad";
+        EXPECT_FALSE(client{bad}.start());
+
+        // a client that has been stopped can connect again.
+        {
+            client::options o;
+            o.Port = s.port();
+            o.Username = "w";
+            client c{o};
+            ASSERT_TRUE(c.start());
+            EXPECT_FALSE(c.start());
+            c.stop();
+            EXPECT_FALSE(c.connected());
+            ASSERT_TRUE(c.start());
+            EXPECT_TRUE(c.connected());
+        }
+
+        // a client whose server hung up can connect again without being stopped.
+        {
+            server::options x = options;
+            server t{pool, x};
+            ASSERT_TRUE(t.start());
+            x.Port = t.port();
+
+            client::options o;
+            o.Port = t.port();
+            o.Username = "w";
+            client c{o};
+            ASSERT_TRUE(c.start());
+
+            t.stop();
+            for (int i = 0; i < 500 && c.connected(); i++) std::this_thread::sleep_for(std::chrono::milliseconds{10});
+            ASSERT_FALSE(c.connected());
+
+            server u{pool, x};
+            ASSERT_TRUE(u.start());
+            ASSERT_TRUE(c.start());
+            EXPECT_TRUE(c.connected());
+        }
+
+        // a server that never answers is given up on.
+        {
+            asio::io_context io;
+            tcp::acceptor silent{io, tcp::endpoint{asio::ip::make_address("127.0.0.1"), 0}};
+
+            client::options o;
+            o.Port = silent.local_endpoint().port();
+            o.Timeout = std::chrono::milliseconds{100};
+            client c{o};
+            EXPECT_FALSE(c.start());
+            EXPECT_FALSE(c.connected());
+        }
+
+        // several clients submit shares from their own threads.
+        std::vector<std::thread> threads;
+        for (int k = 0; k < 4; k++) threads.emplace_back([&s]() {
+            client::options o;
+            o.Port = s.port();
+            o.Username = "w";
+            client c{o};
+            ASSERT_TRUE(c.start());
+
+            std::vector<std::future<bool>> accepted;
+            for (uint32 i = 0; i < 500; i++)
+                accepted.push_back(c.submit(share{"w", 1, uint64_big{1}, Bitcoin::timestamp(1000), nonce{i}}));
+            for (uint32 i = 0; i < 500; i++) EXPECT_EQ(accepted[i].get(), i % 2 == 0);
+        });
+        for (std::thread& t : threads) t.join();
+
+        EXPECT_EQ(pool.Shares, 2000);
+    }
+
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/timechain.hpp>
+#include "blocks.hpp"
+#include "gtest/gtest.h"
+
+namespace Gigamonkey::Bitcoin {
+    
+    TEST(TransactionTest, TestTransactionView) {
+        bytes genesis_coinbase = genesis_coinbase_tx();
+        
+        transaction tx = transaction::read(genesis_coinbase);
+        transaction_view view{genesis_coinbase};
+        
+        EXPECT_TRUE(view.valid());
+        EXPECT_TRUE(transaction::valid(genesis_coinbase));
+        EXPECT_EQ(view.version(), tx.Version);
+        EXPECT_EQ(view.id(), tx.id());
+        
+        ASSERT_EQ(view.inputs().size(), tx.Inputs.size());
+        ASSERT_EQ(view.outputs().size(), tx.Outputs.size());
+        
+        transaction_view::input in = view.inputs()[0];
+        EXPECT_EQ(in.previous(), tx.Inputs.first().Outpoint);
+        EXPECT_EQ(bytes(in.script()), tx.Inputs.first().Script);
+        EXPECT_EQ(in.sequence(), tx.Inputs.first().Sequence);
+        EXPECT_EQ(in.Data, transaction::input(genesis_coinbase, 0));
+        
+        transaction_view::output out = view.outputs()[0];
+        EXPECT_EQ(out.value(), tx.Outputs.first().Value);
+        EXPECT_EQ(bytes(out.script()), tx.Outputs.first().Script);
+        EXPECT_EQ(out.Data, transaction::output(genesis_coinbase, 0));
+        
+        // the script is not copied. 
+        EXPECT_GT(out.script().data(), genesis_coinbase.data());
+        EXPECT_LT(out.script().data(), genesis_coinbase.data() + genesis_coinbase.size());
+        
+        EXPECT_EQ(transaction::input(genesis_coinbase, 1).size(), 0);
+        EXPECT_EQ(transaction::output(genesis_coinbase, 1).size(), 0);
+        
+        // no part of a transaction is a transaction. 
+        for (size_t size = 0; size < genesis_coinbase.size(); size++) {
+            view = bytes_view{genesis_coinbase.data(), size};
+            EXPECT_FALSE(view.valid());
+            EXPECT_EQ(view.inputs().size(), 0);
+        }
+        
+        view = bytes_view(genesis_coinbase);
+        EXPECT_TRUE(view.valid());
+        EXPECT_EQ(transaction(view), tx);
+    }
+    
+    TEST(TransactionTest, TestBlockMerkleRoot) {
+        for (uint32 count : {1, 2, 3, 7, 1000, 3001}) {
+            bytes b = test_block(count);
+            
+            std::vector<bytes_view> txs = block::transactions(b);
+            ASSERT_EQ(txs.size(), count);
+            
+            list<txid> ids{};
+            for (bytes_view x : txs) {
+                EXPECT_TRUE(transaction::valid(x));
+                ids = ids << transaction::read(x).id();
+            }
+            
+            digest256 expected = Merkle::root(ids);
+            for (uint32 threads : {1, 4}) EXPECT_EQ(block::merkle_root(b, threads), expected);
+            
+            // a block that ends early has no transactions. 
+            EXPECT_EQ(block::transactions(bytes_view{b.data(), b.size() - 1}).size(), 0);
+            EXPECT_EQ(block::merkle_root(bytes_view{b.data(), b.size() - 1}), digest256{});
+        }
+    }
+    
+    // transactions with many inputs and outputs, with scripts whose 
+    // sizes are written in every form of var int up to five bytes. 
+    TEST(TransactionTest, TestLongScripts) {
+        struct shape {
+            uint32 Inputs;
+            uint32 Outputs;
+            uint32 ScriptSize;
+        };
+        
+        std::vector<shape> shapes{{1, 1, 0}, {3, 2, 0xfc}, {2, 3, 0xfd}, {300, 2, 40}, 
+            {2, 260, 300}, {1, 2, 0xffff}, {2, 1, 0x10000}, {5, 4, 1000}};
+        
+        std::vector<bytes> txs;
+        for (uint32 n = 0; n < shapes.size(); n++) 
+            txs.push_back(test_transaction(shapes[n].Inputs, shapes[n].Outputs, shapes[n].ScriptSize, n));
+        
+        for (uint32 n = 0; n < shapes.size(); n++) {
+            const shape& x = shapes[n];
+            transaction_view view{txs[n]};
+            ASSERT_TRUE(view.valid());
+            EXPECT_EQ(int32(view.locktime()), int32(n));
+            
+            ASSERT_EQ(view.inputs().size(), x.Inputs);
+            for (uint32 i = 0; i < x.Inputs; i++) {
+                transaction_view::input in = view.inputs()[i];
+                EXPECT_EQ(uint32(in.previous().Index), i);
+                EXPECT_EQ(bytes(in.script()), bytes(x.ScriptSize, byte(i)));
+                EXPECT_EQ(uint32(in.sequence()), 0xffffffff);
+                EXPECT_EQ(in.Data, transaction::input(txs[n], i));
+            }
+            
+            ASSERT_EQ(view.outputs().size(), x.Outputs);
+            for (uint32 i = 0; i < x.Outputs; i++) {
+                transaction_view::output out = view.outputs()[i];
+                EXPECT_EQ(int64(out.value()), int64(1000 + i));
+                EXPECT_EQ(bytes(out.script()), bytes(x.ScriptSize, byte(i)));
+                EXPECT_EQ(out.Data, transaction::output(txs[n], i));
+            }
+        }
+        
+        bytes b = test_block(txs);
+        std::vector<bytes_view> found = block::transactions(b);
+        ASSERT_EQ(found.size(), txs.size());
+        
+        list<txid> ids{};
+        for (uint32 n = 0; n < txs.size(); n++) {
+            EXPECT_EQ(bytes(found[n]), txs[n]);
+            ids = ids << transaction::id(txs[n]);
+        }
+        
+        for (uint32 threads : {1, 4}) EXPECT_EQ(block::merkle_root(b, threads), Merkle::root(ids));
+    }
+    
+}
@@ -3,6 +3,7 @@
 // Distributed under the Open BSV software license, see the accompanying file LICENSE.
 
 #include <gigamonkey/work/proof.hpp>
+#include <gigamonkey/work/solver.hpp>
 #include "dot_cross.hpp"
 #include "gtest/gtest.h"
 #include <iostream>
@@ -64,4 +65,107 @@ namespace Gigamonkey::work {
         
     }
 
+    TEST(WorkTest, TestSolver) {
+        puzzle p{1, sha256(std::string{"solver"}), compact{32, 0x080000}, Merkle::path{}, bytes{}, bytes{}};
+        solution initial{Bitcoin::timestamp(1), 0, 1, 353};
+        
+        for (uint32 threads : {1, 2, 4}) {
+            proof x = solver{threads}.solve(p, initial);
+            EXPECT_TRUE(x.valid());
+            EXPECT_EQ(x.Solution.ExtraNonce1, initial.ExtraNonce1);
+        }
+        
+        // a puzzle that will not be solved before it is cancelled. 
+        puzzle hard{1, sha256(std::string{"hard"}), compact{20, 0x010000}, Merkle::path{}, bytes{}, bytes{}};
+        
+        cancellation stop{};
+        double hashrate = 0;
+        solver s{2};
+        s.ReportInterval = .05;
+        s.Report = [&hashrate, &stop](double h) {
+            hashrate = h;
+            stop.cancel();
+        };
+        
+        EXPECT_FALSE(s.solve(hard, initial, stop).valid());
+        EXPECT_GT(hashrate, 0);
+        
+        // the search still runs without reports. 
+        solver quiet{2};
+        quiet.Report = [](double) {
+            FAIL();
+        };
+        
+        for (double interval : {0., -1.}) {
+            quiet.ReportInterval = interval;
+            EXPECT_TRUE(quiet.solve(p, initial).valid());
+        }
+    }
+    
+    TEST(WorkTest, TestMidstate) {
+        string x{2, sha256(std::string{"previous"}), sha256(std::string{"root"}), Bitcoin::timestamp(1234567), compact{32, 0x080000}, 0};
+        midstate m{x};
+        
+        EXPECT_EQ(m.timestamp(), x.Timestamp);
+        EXPECT_EQ(m.target(), x.Target);
+        
+        for (uint32 n : {0u, 1u, 77777u, 0xffffffffu}) {
+            x.Nonce = n;
+            m.set(nonce{n});
+            EXPECT_EQ(m.nonce(), x.Nonce);
+            EXPECT_EQ(m.hash().Value, x.hash());
+            EXPECT_EQ(m.valid(), x.valid());
+        }
+        
+        x.Timestamp = Bitcoin::timestamp(7654321);
+        m.set(x.Timestamp);
+        EXPECT_EQ(m.hash().Value, x.hash());
+    }
+    
+    TEST(WorkTest, TestNonceScan) {
+        string x{2, sha256(std::string{"previous"}), sha256(std::string{"root"}), Bitcoin::timestamp(1234567), compact{32, 0x080000}, 0};
+        midstate m{x};
+        uint256 target = x.Target.expand();
+        
+        // every nonce that search finds is one that the hash says is valid. 
+        uint32 next = 0;
+        for (int i = 0; i < 20; i++) {
+            ASSERT_TRUE(m.search(next, 1 << 16, target));
+            x.Nonce = m.nonce();
+            EXPECT_TRUE(x.valid());
+            for (uint32 n = next; n < uint32(x.Nonce); n++) {
+                string y = x;
+                y.Nonce = n;
+                EXPECT_FALSE(y.valid());
+            }
+            next = uint32(x.Nonce) + 1;
+        }
+        
+        // every scan kernel that runs on this cpu gives the same candidates as hashing 
+        // one nonce at a time, including counts that are not a multiple of its width. 
+        auto top = [&m](uint32 n) -> uint32 {
+            midstate y = m;
+            y.set(Gigamonkey::nonce{n});
+            return boost::endian::load_little_u32(y.hash().Value.data() + 28);
+        };
+        
+        for (const std::string& engine : Bitcoin::hash256_80_scan_engines())
+            for (uint32 limit : {0x00ffffffu, 0x08000000u, 0xffffffffu})
+                for (uint32 begin : {0u, 0xfffffff9u})
+                    for (uint32 count : {1u, 5u, 13u, 37u, 100u}) {
+                        uint32 candidates[16];
+                        uint32 found;
+                        uint32 scanned = Bitcoin::hash256_80_scan(engine, 
+                            m.State.data(), m.Tail.data(), begin, count, limit, candidates, found);
+                        ASSERT_GT(scanned, 0) << engine;
+                        ASSERT_LE(scanned, count) << engine;
+                        if (found == 0) EXPECT_EQ(scanned, count) << engine;
+                        
+                        std::vector<uint32> expected;
+                        for (uint32 i = 0; i < scanned; i++) if (top(begin + i) <= limit) expected.push_back(begin + i);
+                        EXPECT_EQ(std::vector<uint32>(candidates, candidates + found), expected) << engine;
+                    }
+    }
+    
 }
+
@@ -46,6 +46,17 @@ namespace Gigamonkey::Bitcoin {
         
         EXPECT_EQ(work_string_written, header_written);
         
+        EXPECT_EQ(bytes_view(header_written), bytes_view(genesis_header_bytes));
+        
+        // write straight into a buffer. 
+        std::array<byte, 80> header_array;
+        header.write(header_array);
+        EXPECT_EQ(bytes_view(header_array.data(), 80), bytes_view(genesis_header_bytes));
+        
+        std::array<byte, 80> work_string_array{};
+        EXPECT_EQ(work_string.write(work_string_array.data()), work_string_array.data() + 80);
+        EXPECT_EQ(work_string_array, header_array);
+        
         EXPECT_EQ(work_string.hash(), digest256("0x000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f"));
         
         EXPECT_EQ(header.hash(), digest256("0x000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f"));